@@ -0,0 +1,52 @@
+#include "Arena.h"
+
+Arena::Arena(size_t blockSize)
+	: current(0)
+	, offset(0)
+	, blockSize(blockSize)
+	, used(0)
+	, reserved(0)
+{
+}
+
+Arena::~Arena()
+{
+	for (auto& block : blocks)
+	{
+		delete[] block.data;
+	}
+}
+
+void* Arena::Allocate(size_t bytes, size_t align)
+{
+	while (current < blocks.size())
+	{
+		Block& block = blocks[current];
+		size_t start = (offset + align - 1) & ~(align - 1);
+		if (start + bytes <= block.size)
+		{
+			offset = start + bytes;
+			used += bytes;
+			return block.data + start;
+		}
+		// doesn't fit, the rest of this block is wasted until Release
+		current++;
+		offset = 0;
+	}
+
+	// new[] is aligned for anything, so a fresh block always starts aligned
+	size_t size = std::max(blockSize, bytes);
+	blocks.push_back(Block{ new char[size], size });
+	reserved += size;
+	current = blocks.size() - 1;
+	offset = bytes;
+	used += bytes;
+	return blocks.back().data;
+}
+
+void Arena::Release()
+{
+	current = 0;
+	offset = 0;
+	used = 0;
+}
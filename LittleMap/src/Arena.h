@@ -0,0 +1,78 @@
+#pragma once
+#include "ofMain.h"
+
+#include <vector>
+#include <type_traits>
+
+// Monotonic allocator for data that lives until the next Reset. Allocation is a pointer bump,
+// freeing is a no-op, and Release hands everything back at once while keeping the blocks,
+// so after the first map there's no malloc traffic at all.
+class Arena
+{
+public:
+	Arena(size_t blockSize = 1 << 20);
+	~Arena();
+
+	void* Allocate(size_t bytes, size_t align);
+	// everything allocated so far is gone; destroy anything using it first
+	void Release();
+
+	size_t GetUsed() const { return used; }
+	size_t GetReserved() const { return reserved; }
+
+private:
+	Arena(const Arena&) = delete;
+	Arena& operator=(const Arena&) = delete;
+
+	struct Block {
+		char* data;
+		size_t size;
+	};
+
+	vector<Block> blocks;
+	int current;
+	size_t offset;
+	size_t blockSize;
+	size_t used;
+	size_t reserved;
+};
+
+// STL allocator on top of an Arena. A default constructed one has no arena and falls back to
+// new/delete, so containers holding them can still be default constructed.
+template <class T>
+struct ArenaAllocator
+{
+	typedef T value_type;
+	typedef std::true_type propagate_on_container_copy_assignment;
+	typedef std::true_type propagate_on_container_move_assignment;
+	typedef std::true_type propagate_on_container_swap;
+
+	ArenaAllocator() : arena(nullptr) {}
+	ArenaAllocator(Arena* arena) : arena(arena) {}
+	template <class U>
+	ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.arena) {}
+
+	T* allocate(size_t n)
+	{
+		if (arena == nullptr)
+			return static_cast<T*>(::operator new(n * sizeof(T)));
+		return static_cast<T*>(arena->Allocate(n * sizeof(T), alignof(T)));
+	}
+
+	void deallocate(T* p, size_t n)
+	{
+		// arena memory comes back all at once in Release
+		if (arena == nullptr)
+			::operator delete(p);
+	}
+
+	Arena* arena;
+};
+
+template <class T, class U>
+bool operator==(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) { return a.arena == b.arena; }
+template <class T, class U>
+bool operator!=(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) { return a.arena != b.arena; }
+
+template <class T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
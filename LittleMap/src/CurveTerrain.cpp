@@ -1,12 +1,34 @@
 #include "CurveTerrain.h"
-#include "Noise.h"
+#include "PolylineCursor.h"
+#include "Snapshot.h"
+#include "Simplify.h"
+
+#include <chrono>
+#include <thread>
 
 const int cellSize = 10;
 const float noiseScale = 0.015f;
-const int noiseOctaves = 5;
-
-
-CurveTerrain::CurveTerrain(bool debug, bool drawNoise)
+const NoiseOctaves landOctaves(5, 0.5f, 0.6f);
+const float seaLevel = 0.45f;
+const ofColor landFillColor(90, 195, 140, 255);
+const ofColor seaFillColor(150, 200, 255, 255);
+// fill islands on the CPU with ScanlineFill rather than tessellating them
+const bool scanlineIslandFill = true;
+// Show a quarter resolution draft of the land straight away, which stays up while the
+// real thing is generated.
+const bool progressiveTerrain = true;
+const int draftScale = 4;
+// Coastlines are the smooth curve through the cell crossings, cut into lines within
+// coastFlatness of it then thinned to within coastTolerance, together well under a stipple.
+const float coastFlatness = 0.1f;
+const float coastTolerance = 0.25f;
+
+
+CurveTerrain::CurveTerrain(Generator& generator, bool debug, bool drawNoise)
+	: generator(generator)
+	, noiseSource(generator, noiseScale, landOctaves, seaLevel)
+	, source(&noiseSource)
+	, draftReady(false)
 {
 	this->debug = debug;
 	this->drawNoise = drawNoise;
@@ -14,8 +36,8 @@ CurveTerrain::CurveTerrain(bool debug, bool drawNoise)
 	landColor[0] = ofColor( 90, 140, 195, 255);
 	landColor[1] = ofColor(110, 160, 215, 255);
 	landColor[2] = ofColor(130, 180, 235, 255);
-	landColor[3] = ofColor(150, 200, 255, 255);
-	landColor[4] = ofColor( 90, 195, 140, 255);
+	landColor[3] = seaFillColor;
+	landColor[4] = landFillColor;
 	landColor[5] = ofColor(110, 215, 160, 255);
 	landColor[6] = ofColor(130, 235, 180, 255);
 	landColor[7] = ofColor(150, 255, 200, 255);
@@ -34,24 +56,24 @@ void CurveTerrain::Setup()
 	cellHeight = ofGetHeight() / cellSize;
 	cells = new Cell[cellWidth * cellHeight];
 
-	noiseMap = new float[ofGetWidth() * ofGetHeight()];
+	noiseMap = new float[ofGetWidth() * ofGetHeight()]();
 
 	Reset();
 }
 
 void CurveTerrain::Reset()
 {
-	for (int y = 0; y < ofGetHeight(); y++)
-	{
-		for (int x = 0; x < ofGetWidth(); x++)
-		{
-			float landValue = ComputeLandValue(x, y);
-			noiseMap[x + y * ofGetWidth()] = landValue;
-		}
-	}
-
 	render_x = 0;
 	render_y = 0;
+	draftReady = false;
+	draftUploaded = false;
+	rendered = false;
+	coastlines.clear();
+	coastDrawLand.clear();
+	shoreDistance.Clear();
+	islandFills.clear();
+	islandFills.setMode(OF_PRIMITIVE_TRIANGLES);
+	islandRaster.Setup(ofGetWidth(), ofGetHeight());
 
 	if (image.isAllocated())
 		image.clear();
@@ -61,6 +83,32 @@ void CurveTerrain::Reset()
 	image.end();
 }
 
+// Done when rendering starts rather than in Reset, since Start (and so the seed) is reset last.
+void CurveTerrain::ComputeNoiseMap()
+{
+	for (int y = 0; y < ofGetHeight(); y++)
+	{
+		source->LandRow(&noiseMap[y * ofGetWidth()], ofGetWidth(), 0, 1, y);
+	}
+}
+
+bool CurveTerrain::LoadRaster(const std::string& path)
+{
+	if (!rasterSource.Open(path))
+	{
+		UseNoise();
+		return false;
+	}
+	source = &rasterSource;
+	return true;
+}
+
+void CurveTerrain::UseNoise()
+{
+	source = &noiseSource;
+	rasterSource.Close();
+}
+
 void CurveTerrain::RenderNoiseMap()
 {
 	ofPixels pixels = ofPixels();
@@ -71,18 +119,13 @@ void CurveTerrain::RenderNoiseMap()
 		for (int x = 0; x < ofGetWidth(); x++)
 		{
 			float landValue = GetLandValue(x, y);
-			ofColor color = ofColor((landValue + 0.45f) * 255);
+			ofColor color = ofColor((landValue + seaLevel) * 255);
 			pixels.setColor(x, y, color);
 		}
 	}
 	image.getTexture().loadData(pixels);
 }
 
-float CurveTerrain::ComputeLandValue(float x, float y)
-{
-	return Noise(x*noiseScale, y*noiseScale, noiseOctaves, 0.5f, 0.6f) - 0.45f;
-}
-
 float Clamp(float v, float min, float max)
 {
 	return std::min(max, std::max(min, v));
@@ -95,6 +138,11 @@ float CurveTerrain::GetLandValue(float x, float y)
 	return noiseMap[ix + iy * ofGetWidth()];
 }
 
+GridSample CurveTerrain::SampleLand(float x, float y)
+{
+	return SampleBilinear(noiseMap, ofGetWidth(), ofGetHeight(), x, y);
+}
+
 // Takes floats but expects cell coordinates.
 float CurveTerrain::OnLand(float x, float y)
 {
@@ -247,19 +295,22 @@ bool CurveTerrain::DrawIsland(int x, int y)
 	if (d == none)
 		return false;
 
-	ofPolyline path = ofPolyline();
+	// built in place, it's kept as a coastline afterwards
+	coastlines.push_back(ofPolyline());
+	ofPolyline& path = coastlines.back();
 	//path.setStrokeWidth(3);
 	//path.setStrokeColor(lineColor);
 
+	coastControls.clear();
 	ofPoint linkPos = LinkPos(x, y, d, next->bias);
-	// ofPath doesn't draw the first or last points, they are just control points for the curve, 
+	// The curve doesn't draw the first or last points, they are just control points for the curve, 
 	// so we will draw the entrance and exit points in the start cell.
 	// This makes the first Drawn point the exit of the first cell.
-	path.curveTo(linkPos);
+	coastControls.push_back(linkPos);
 	do {
 		next->visited = true;
 		linkPos = LinkPos(x, y, next->tile.links[d], next->bias);
-		path.curveTo(linkPos);
+		coastControls.push_back(linkPos);
 
 		NextCell(x, y, d, x, y, d);
 		next = &cells[y*cellWidth + x];
@@ -267,43 +318,94 @@ bool CurveTerrain::DrawIsland(int x, int y)
 	// ... and since the last Drawn point also needs, to be the exit of the first cell,
 	// we draw through the first cell AGAIN, and the second cell AGAIN! Nice....
 	linkPos = LinkPos(x, y, next->tile.links[d], next->bias);
-	path.curveTo(linkPos);
+	coastControls.push_back(linkPos);
 
 	NextCell(x, y, d, x, y, d);
 	next = &cells[y*cellWidth + x];
 
 	linkPos = LinkPos(x, y, next->tile.links[d], next->bias);
-	path.curveTo(linkPos);
+	coastControls.push_back(linkPos);
 
-	ofSetColor(next->tile.drawLand ? landColor[4] : landColor[3]);
-	ofFill();
-	ofEnableSmoothing();
+	// the same curve curveTo would make, in a tenth of the points or less
+	coastCurve.clear();
+	FlattenCatmullRom(coastControls, coastFlatness, coastCurve);
+	SimplifyDouglasPeucker(coastCurve, coastTolerance, path.getVertices());
+
+	coastDrawLand.push_back(next->tile.drawLand);
+	FillIsland(path, next->tile.drawLand);
 
-	if (!debug)
+	return true;
+}
+
+void CurveTerrain::FillIsland(const ofPolyline& path, bool drawLand)
+{
+	ofColor fillColor = drawLand ? landColor[4] : landColor[3];
+
+	if (debug)
+	{
+		ofSetColor(fillColor);
+		ofFill();
+		ofEnableSmoothing();
+		StippleCoast(path);
+	}
+	else if (scanlineIslandFill)
 	{
-		ofTessellator tesselator = ofTessellator();
-		ofMesh mesh;
-		tesselator.tessellateToMesh(path, ofPolyWindingMode::OF_POLY_WINDING_ODD, mesh);
-		mesh.draw();
+		islandRaster.Fill(path, fillColor);
 	}
+	else
+	{
+		// fills all go into one mesh, drawn in one go by DrawCoastlines once the scan is done
+		tessellator.tessellateToMesh(path, ofPolyWindingMode::OF_POLY_WINDING_ODD, islandMesh);
+		int base = islandFills.getNumVertices();
+		islandFills.addVertices(islandMesh.getVertices());
+		for (int i = 0; i < islandMesh.getNumVertices(); i++)
+		{
+			islandFills.addColor(fillColor);
+		}
+		for (auto index : islandMesh.getIndices())
+		{
+			islandFills.addIndex(index + base);
+		}
+	}
+}
 
-	if (!debug)
+void CurveTerrain::StippleCoast(const ofPolyline& path)
+{
+	PolylineCursor cursor(path);
+	while (!cursor.Done())
 	{
-		ofSetColor(ofColor::black);
+		ofPoint pt = cursor.GetPoint();
+		
+		ofDrawCircle(pt, rng.Range(1.5f, 3.0f));
+
+		cursor.Advance(1);
 	}
+}
+
+void CurveTerrain::DrawCoastlines()
+{
+	image.begin();
 	ofFill();
 	ofEnableSmoothing();
-	float len = 0;
-	while (path.getIndexAtLength(len) < path.size()-1) // apparently size - 1....
+	if (scanlineIslandFill)
 	{
-		ofPoint pt = path.getPointAtLength(len);
-		
-		ofDrawCircle(pt, ofRandom(1.5f, 3.0f));
-
-		len += 1;
+		// the raster started out as the sea colour, so it replaces the whole background
+		islandTexture.loadData(islandRaster.GetPixels());
+		ofSetColor(ofColor::white);
+		islandTexture.draw(0, 0);
+	}
+	else
+	{
+		islandFills.draw();
 	}
 
-	return true;
+	// coastlines in the order they were found, so the stipples use rng the same way
+	ofSetColor(ofColor::black);
+	for (auto& coast : coastlines)
+	{
+		StippleCoast(coast);
+	}
+	image.end();
 }
 
 void CurveTerrain::RenderBegin()
@@ -321,6 +423,12 @@ void CurveTerrain::RenderBegin()
 
 	ofSetColor(0, 0, 255, 255);
 	ofSetLineWidth(1);
+	ScanCells();
+}
+
+// Picks every cell's tile. Only draws anything in debug mode.
+void CurveTerrain::ScanCells()
+{
 	for (int y = 0; y < cellHeight; y++)
 	{
 		for (int x = 0; x < cellWidth; x++)
@@ -379,6 +487,10 @@ bool CurveTerrain::DoRender()
 
 	if (render_x == 0 && render_y == 0)
 	{
+		// debug mode already has it from Generate
+		if (!debug)
+			ComputeNoiseMap();
+		rng = generator.GetStream(Generator::StreamTerrain);
 		RenderBegin();
 	}
 	else
@@ -400,6 +512,61 @@ bool CurveTerrain::DoRender()
 	return false;
 }
 
+// Everything but the drawing, off the GL thread. A row of cells per call, so a reset never
+// waits long for it. Debug mode draws as it scans, so that all still happens in Render.
+bool CurveTerrain::Generate()
+{
+	if (debug)
+	{
+		// no coasts, but later stages still ask how far they are, and the field reads the
+		// land values, so they're filled here rather than on the first DoRender
+		ComputeNoiseMap();
+		BuildShoreDistance();
+		return true;
+	}
+
+	if (progressiveTerrain && !draftReady)
+	{
+		BuildDraft();
+		return false;
+	}
+
+	if (render_y == cellHeight)
+		return true;
+
+	if (render_x == 0 && render_y == 0)
+	{
+		ComputeNoiseMap();
+		rng = generator.GetStream(Generator::StreamTerrain);
+		islandRaster.Clear(landColor[3]);
+		ScanCells();
+	}
+
+	for (render_x = 0; render_x < cellWidth; render_x++)
+	{
+		if (!cells[render_y*cellWidth + render_x].visited)
+			DrawIsland(render_x, render_y);
+	}
+	render_x = 0;
+	render_y++;
+
+	if (render_y < cellHeight)
+		return false;
+
+	int points = 0;
+	for (auto& coast : coastlines)
+		points += coast.size();
+	printf("%d coastlines in %d points\n", (int)coastlines.size(), points);
+
+	BuildShoreDistance();
+	return true;
+}
+
+void CurveTerrain::BuildShoreDistance()
+{
+	shoreDistance.Build(ofGetWidth(), ofGetHeight(), coastlines, noiseMap, std::max(1, (int)std::thread::hardware_concurrency()));
+}
+
 bool CurveTerrain::Render()
 {
 	if (debug)
@@ -414,17 +581,153 @@ bool CurveTerrain::Render()
 	}
 	else
 	{
-		while (!DoRender()) {}
+		// Generate has done the rest
+		image.begin();
+		ofClear(landColor[3]);
+		image.end();
+		DrawCoastlines();
+		rendered = true;
 		return true;
 	}
 }
 
+// The land values, which later stages sample, and the coastlines. The fills are quick to
+// redo from the coastlines, so they aren't kept.
+bool CurveTerrain::WriteSnapshot(SnapshotWriter& out)
+{
+	if (debug)
+		return false;
+
+	out.WriteArray(noiseMap, ofGetWidth() * ofGetHeight());
+	out.Write((int)coastlines.size());
+	for (int i = 0; i < coastlines.size(); i++)
+	{
+		out.WritePolyline(coastlines[i]);
+		out.Write((bool)coastDrawLand[i]);
+	}
+	return true;
+}
+
+bool CurveTerrain::ReadSnapshot(SnapshotReader& in)
+{
+	int count;
+	if (debug || !in.ReadArray(noiseMap, ofGetWidth() * ofGetHeight())
+		|| !in.ReadCount(count, SnapshotReader::minPolylineBytes + sizeof(bool)))
+		return false;
+
+	islandRaster.Clear(landColor[3]);
+	coastlines.resize(count);
+	for (auto& coast : coastlines)
+	{
+		bool drawLand;
+		if (!in.ReadPolyline(coast) || !in.Read(drawLand))
+			return false;
+		coastDrawLand.push_back(drawLand);
+		FillIsland(coast, drawLand);
+	}
+
+	BuildShoreDistance();
+
+	// Render stipples the coasts with it
+	rng = generator.GetStream(Generator::StreamTerrain);
+	render_x = 0;
+	render_y = cellHeight;
+	return true;
+}
+
+// The same land the full map uses, sampled every draftScale pixels, land or sea by the same
+// threshold. Scaled up with linear filtering it's close enough to read the map's shape.
+// Draw uploads it, since this runs on the worker.
+void CurveTerrain::BuildDraft()
+{
+	std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+	int width = ofGetWidth() / draftScale;
+	int height = ofGetHeight() / draftScale;
+	draftRow.resize(width);
+	draftPixels.allocate(width, height, 3);
+	for (int y = 0; y < height; y++)
+	{
+		source->LandRow(draftRow.data(), width, 0, draftScale, y * draftScale);
+		for (int x = 0; x < width; x++)
+		{
+			draftPixels.setColor(x, y, draftRow[x] > 0 ? landColor[4] : landColor[3]);
+		}
+	}
+	draftReady = true;
+
+	float elapsed = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+	printf("Terrain draft in %.2fms\n", elapsed);
+}
+
 void CurveTerrain::Draw()
 {
-	if(image.isAllocated())
+	if (draftReady && !draftUploaded)
+	{
+		draftTexture.loadData(draftPixels);
+		draftUploaded = true;
+	}
+
+	// until the coastlines are drawn the real image is empty
+	if (draftUploaded && !rendered)
+	{
+		ofSetColor(ofColor::white);
+		draftTexture.draw(0, 0, ofGetWidth(), ofGetHeight());
+	}
+	else if(image.isAllocated())
 		image.draw(0, 0);
 }
 
+// The coastlines, thinned out to half a pixel at this scale, filled at the level's own size so
+// the edges stay sharp, then stippled like DrawCoastlines does.
+void CurveTerrain::DrawLevel(float scale)
+{
+	if (debug || !rendered)
+	{
+		Stage::DrawLevel(scale);
+		return;
+	}
+
+	int width = (int)std::ceil(ofGetWidth() * scale);
+	int height = (int)std::ceil(ofGetHeight() * scale);
+	ScanlineFill levelRaster;
+	levelRaster.Setup(width, height);
+	levelRaster.Clear(landColor[3]);
+
+	vector<ofPolyline> levelCoasts(coastlines.size());
+	ofPolyline scaled;
+	for (int i = 0; i < coastlines.size(); i++)
+	{
+		SimplifyDouglasPeucker(coastlines[i].getVertices(), 0.5f / scale, levelCoasts[i].getVertices());
+		scaled.clear();
+		for (auto& pt : levelCoasts[i].getVertices())
+		{
+			scaled.addVertex(pt * scale);
+		}
+		levelRaster.Fill(scaled, coastDrawLand[i] ? landColor[4] : landColor[3]);
+	}
+
+	ofTexture levelTexture;
+	levelTexture.loadData(levelRaster.GetPixels());
+	ofSetColor(ofColor::white);
+	levelTexture.draw(0, 0);
+
+	// its own stream, so exporting doesn't change the map
+	Random mainRng = rng;
+	rng = generator.GetStream(Generator::StreamTerrain);
+	ofPushMatrix();
+	ofScale(scale, scale);
+	ofFill();
+	ofEnableSmoothing();
+	ofSetColor(ofColor::black);
+	for (auto& coast : levelCoasts)
+	{
+		StippleCoast(coast);
+	}
+	ofPopMatrix();
+	rng = mainRng;
+}
+
 void CurveTerrain::SetupTiles()
 {
 	// RULE IS: 1 on the left, 0 on the right
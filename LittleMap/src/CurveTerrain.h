@@ -2,17 +2,52 @@
 #include "Stage.h"
 #include "ofMain.h"
 
+#include "Generator.h"
+#include "ScanlineFill.h"
+#include "GridSample.h"
+#include "DistanceField.h"
+#include "TerrainSource.h"
+
+#include <atomic>
+
+// The land's lattice, noise and colours. World draws its chunks from these too, so they always
+// look like pieces of the same map.
+extern const int cellSize;
+extern const float noiseScale;
+extern const NoiseOctaves landOctaves;
+// taken off the noise, so land is above 0 and sea below
+extern const float seaLevel;
+extern const ofColor landFillColor;
+extern const ofColor seaFillColor;
+
 class CurveTerrain : public Stage
 {
 public:
-	CurveTerrain(bool debug, bool drawNoise=false);
+	CurveTerrain(Generator& generator, bool debug, bool drawNoise=false);
 	~CurveTerrain();
 
 	virtual void Setup();
+	virtual bool Generate();
 	virtual bool Render();
 	virtual void Draw();
+	virtual void DrawLevel(float scale);
+	virtual bool WriteSnapshot(SnapshotWriter& out);
+	virtual bool ReadSnapshot(SnapshotReader& in);
+
+	// Land from a heightfield file rather than noise, until UseNoise. Not while the worker
+	// is running. False, and back to noise, if the file can't be read.
+	bool LoadRaster(const std::string& path);
+	void UseNoise();
 
 	float GetLandValue(float x, float y);
+	// interpolated between pixels, with the slope
+	GridSample SampleLand(float x, float y);
+	// every value GetLandValue can return, ofGetWidth() to a row
+	const float* GetLandValues() const { return noiseMap; }
+	const vector<ofPolyline>& GetCoastlines() { return coastlines; }
+	// pixels to the nearest coastline, positive on land and negative at sea; ready once Generate is done
+	float GetShoreDistance(float x, float y) const { return shoreDistance.Get(x, y); }
+	const float* GetShoreDistances() const { return shoreDistance.GetValues(); }
 
 	enum dir {
 		top,
@@ -33,14 +68,19 @@ public:
 	};
 
 private:
+	Generator& generator;
+	Random rng;
+
 	// config
 	bool debug = false;
 	bool drawNoise = false;
 	ofColor landColor[8];
 	ofColor lineColor;
 
+	void ComputeNoiseMap();
 	void RenderNoiseMap();
 	void RenderBegin();
+	void ScanCells();
 	void RenderStep();
 	bool DoRender();
 	void Reset();
@@ -49,9 +89,12 @@ private:
 	int render_y;
 
 	ofFbo image;
+	// land values for every pixel, from whichever source
 	float* noiseMap;
+	NoiseTerrain noiseSource;
+	RasterTerrain rasterSource;
+	const TerrainSource* source;
 
-	float ComputeLandValue(float x, float y);
 	float OnLand(float x, float y);
 	void Biases(float biases[4], int x, int y);
 	void BHits(float biases[4], int hits[4]);
@@ -65,6 +108,9 @@ private:
 	ofPoint LinkPos(int x, int y, dir end, float bias[4]);
 	void NextCell(int x, int y, dir currentDir, int &outx, int &outy, dir &nextDir);
 	bool DrawIsland(int cellx, int celly);
+	void FillIsland(const ofPolyline& path, bool drawLand);
+	void StippleCoast(const ofPolyline& path);
+	void DrawCoastlines();
 
 	void SetupTiles();
 	Tile tiles[16];
@@ -72,5 +118,29 @@ private:
 	int cellWidth;
 	int cellHeight;
 	Cell* cells;
+
+	vector<ofPolyline> coastlines;
+	// which colour each coastline was filled with
+	vector<bool> coastDrawLand;
+	// kept between islands so tessellating one doesn't allocate
+	ofTessellator tessellator;
+	vector<ofPoint> coastControls;
+	vector<ofPoint> coastCurve;
+	ofMesh islandMesh;
+	// every island's fill, vertex coloured
+	ofMesh islandFills;
+	ScanlineFill islandRaster;
+	DistanceField shoreDistance;
+	void BuildShoreDistance();
+	ofTexture islandTexture;
+
+	void BuildDraft();
+	// set by the worker once draftPixels is filled in
+	std::atomic<bool> draftReady;
+	bool draftUploaded = false;
+	bool rendered = false;
+	vector<float> draftRow;
+	ofPixels draftPixels;
+	ofTexture draftTexture;
 };
 
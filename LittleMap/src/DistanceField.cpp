@@ -0,0 +1,141 @@
+#include "DistanceField.h"
+
+#include <chrono>
+#include <thread>
+
+// stands in for infinity; far enough that no real squared distance gets near it
+const float farAway = 1e20f;
+
+// The lower envelope of the parabolas (q - i)^2 + f[i], sampled at every q. v and z are scratch
+// for the envelope's parabolas and the boundaries between them, n and n + 1 long.
+static void Transform1D(const float* f, int n, float* d, int* v, float* z)
+{
+	int k = 0;
+	v[0] = 0;
+	z[0] = -farAway;
+	z[1] = farAway;
+	for (int q = 1; q < n; q++)
+	{
+		float s = ((f[q] + q * q) - (f[v[k]] + v[k] * v[k])) / (2 * q - 2 * v[k]);
+		while (s <= z[k])
+		{
+			k--;
+			s = ((f[q] + q * q) - (f[v[k]] + v[k] * v[k])) / (2 * q - 2 * v[k]);
+		}
+		k++;
+		v[k] = q;
+		z[k] = s;
+		z[k + 1] = farAway;
+	}
+
+	k = 0;
+	for (int q = 0; q < n; q++)
+	{
+		while (z[k + 1] < q)
+			k++;
+		d[q] = (q - v[k]) * (q - v[k]) + f[v[k]];
+	}
+}
+
+DistanceField::DistanceField()
+	: width(0)
+	, height(0)
+{
+}
+
+DistanceField::~DistanceField()
+{
+}
+
+void DistanceField::Clear()
+{
+	field.clear();
+}
+
+void DistanceField::TransformColumns(int first, int last)
+{
+	vector<float> column(height);
+	vector<float> out(height);
+	vector<int> v(height);
+	vector<float> z(height + 1);
+	for (int x = first; x < last; x++)
+	{
+		for (int y = 0; y < height; y++)
+			column[y] = field[x + y * width];
+		Transform1D(column.data(), height, out.data(), v.data(), z.data());
+		for (int y = 0; y < height; y++)
+			field[x + y * width] = out[y];
+	}
+}
+
+void DistanceField::TransformRows(int first, int last)
+{
+	vector<float> out(width);
+	vector<int> v(width);
+	vector<float> z(width + 1);
+	for (int y = first; y < last; y++)
+	{
+		float* row = &field[y * width];
+		Transform1D(row, width, out.data(), v.data(), z.data());
+		std::copy(out.begin(), out.end(), row);
+	}
+}
+
+void DistanceField::Build(int width, int height, const vector<ofPolyline>& contours, const float* inside, int threads)
+{
+	std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+	this->width = width;
+	this->height = height;
+	field.assign(width * height, farAway);
+
+	// every pixel a contour passes through is at distance 0
+	for (auto& contour : contours)
+	{
+		const vector<ofPoint>& points = contour.getVertices();
+		int count = contour.isClosed() ? points.size() : points.size() - 1;
+		for (int i = 0; i < count; i++)
+		{
+			ofPoint a = points[i];
+			ofPoint b = points[(i + 1) % points.size()];
+			int steps = (int)std::ceil(a.distance(b)) + 1;
+			for (int s = 0; s <= steps; s++)
+			{
+				ofPoint p = a + (b - a) * ((float)s / steps);
+				int x = (int)std::round(p.x);
+				int y = (int)std::round(p.y);
+				if (x >= 0 && y >= 0 && x < width && y < height)
+					field[x + y * width] = 0;
+			}
+		}
+	}
+
+	threads = std::max(1, threads);
+	vector<std::thread> workers;
+	for (int t = 0; t < threads; t++)
+		workers.push_back(std::thread(&DistanceField::TransformColumns, this, width * t / threads, width * (t + 1) / threads));
+	for (auto& worker : workers)
+		worker.join();
+
+	workers.clear();
+	for (int t = 0; t < threads; t++)
+		workers.push_back(std::thread(&DistanceField::TransformRows, this, height * t / threads, height * (t + 1) / threads));
+	for (auto& worker : workers)
+		worker.join();
+
+	for (int i = 0; i < field.size(); i++)
+	{
+		float distance = std::sqrt(field[i]);
+		field[i] = inside[i] > 0 ? distance : -distance;
+	}
+
+	float elapsed = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+	printf("Built distance field on %d threads in %.2fms\n", threads, elapsed);
+}
+
+float DistanceField::Get(float x, float y) const
+{
+	int ix = (int)std::floor(std::min((float)(width - 1), std::max(0.0f, x)));
+	int iy = (int)std::floor(std::min((float)(height - 1), std::max(0.0f, y)));
+	return field[ix + iy * width];
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include "ofMain.h"
+
+#include <vector>
+
+// Signed distance in pixels from every pixel to the nearest contour: positive where inside
+// says so, negative elsewhere. Exact Euclidean distances to the contours' pixels, in linear
+// time (Felzenszwalb and Huttenlocher's transform, a column pass then a row pass), with each
+// pass split over threads.
+class DistanceField
+{
+public:
+	DistanceField();
+	~DistanceField();
+
+	// inside is width * height values, with the positive ones inside
+	void Build(int width, int height, const vector<ofPolyline>& contours, const float* inside, int threads);
+	void Clear();
+	bool IsBuilt() const { return !field.empty(); }
+
+	// nearest pixel, clamped to the edges
+	float Get(float x, float y) const;
+	const float* GetValues() const { return field.data(); }
+
+private:
+	void TransformColumns(int first, int last);
+	void TransformRows(int first, int last);
+
+	int width;
+	int height;
+	// squared distances until the end of Build
+	vector<float> field;
+};
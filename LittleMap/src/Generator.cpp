@@ -0,0 +1,33 @@
+#include "Generator.h"
+
+Generator::Generator()
+	: noiseMode(NoiseSeeded)
+{
+	Seed(0);
+}
+
+void Generator::Seed(int seed)
+{
+	this->seed = seed;
+	SeedNoise(noise, seed, noiseMode);
+}
+
+float Generator::Noise(float x, float y, const NoiseOctaves& octaves) const
+{
+	return ::Noise(noise, x, y, octaves);
+}
+
+void Generator::NoiseRow(float* out, int count, float startX, float stepX, float y, float scale, const NoiseOctaves& octaves) const
+{
+	::NoiseRow(noise, out, count, startX, stepX, y, scale, octaves);
+}
+
+Random Generator::GetStream(Stream stream) const
+{
+	return Random(GetStreamSeed(stream));
+}
+
+uint64_t Generator::GetStreamSeed(Stream stream) const
+{
+	return ((uint64_t)(uint32_t)seed << 32) ^ ((uint64_t)stream * 0x9E3779B97F4A7C15ull);
+}
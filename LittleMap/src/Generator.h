@@ -0,0 +1,42 @@
+#pragma once
+#include "ofMain.h"
+
+#include "Noise.h"
+#include "Random.h"
+
+// Everything one map draws its randomness from. Start owns it and reseeds it, the other
+// stages hold a reference to it. Nothing in here is global, so two maps can be generated
+// side by side, and stages can run on other threads.
+class Generator
+{
+public:
+	// One independent random stream per stage, so stages don't disturb each other's
+	// sequences no matter what order, or on which thread, they run.
+	enum Stream {
+		StreamTerrain,
+		StreamLatLon,
+		StreamLandmarks,
+		StreamPaths,
+		StreamLegend,
+		StreamPaper,
+	};
+
+	Generator();
+
+	void Seed(int seed);
+	int GetSeed() const { return seed; }
+
+	void SetNoiseMode(NoiseMode mode) { noiseMode = mode; }
+
+	float Noise(float x, float y, const NoiseOctaves& octaves) const;
+	void NoiseRow(float* out, int count, float startX, float stepX, float y, float scale, const NoiseOctaves& octaves) const;
+
+	Random GetStream(Stream stream) const;
+	// what GetStream seeds its Random with, for keyed CounterRandom streams
+	uint64_t GetStreamSeed(Stream stream) const;
+
+private:
+	int seed;
+	NoiseMode noiseMode;
+	NoiseSeed noise;
+};
@@ -0,0 +1,44 @@
+#include "GridSample.h"
+
+#include <cfloat>
+
+float GridSample::DistanceToZero() const
+{
+	float slope = std::sqrt(dx * dx + dy * dy);
+	if (slope == 0)
+		return FLT_MAX;
+	return std::abs(value) / slope;
+}
+
+// Which cell v is in along an axis, and how far across it. Slope is 0 past the edges.
+static inline void Locate(float v, int size, int& i, float& t, float& slope)
+{
+	slope = v < 0 || v > size - 1 ? 0.0f : 1.0f;
+	v = std::min((float)(size - 1), std::max(0.0f, v));
+	i = (int)v;
+	t = v - i;
+}
+
+GridSample SampleBilinear(const float* grid, int width, int height, float x, float y)
+{
+	int ix, iy;
+	float tx, ty, slopeX, slopeY;
+	Locate(x, width, ix, tx, slopeX);
+	Locate(y, height, iy, ty, slopeY);
+	int ix1 = std::min(ix + 1, width - 1);
+	int iy1 = std::min(iy + 1, height - 1);
+
+	float v00 = grid[ix + iy * width];
+	float v10 = grid[ix1 + iy * width];
+	float v01 = grid[ix + iy1 * width];
+	float v11 = grid[ix1 + iy1 * width];
+
+	float top = v00 + (v10 - v00) * tx;
+	float bottom = v01 + (v11 - v01) * tx;
+
+	GridSample sample;
+	sample.value = top + (bottom - top) * ty;
+	sample.dx = ((v10 - v00) + ((v11 - v01) - (v10 - v00)) * ty) * slopeX;
+	sample.dy = (bottom - top) * slopeY;
+	return sample;
+}
@@ -0,0 +1,19 @@
+#pragma once
+#include "ofMain.h"
+
+// Interpolated lookups into a width x height grid of floats, like the terrain's land values.
+// Grid value i + j * width sits at (i, j), so on whole numbers these give back exactly what a
+// nearest lookup would. Past the edges the grid is clamped, and so flat.
+
+// A value and its slope, in value per grid step.
+struct GridSample
+{
+	float value;
+	float dx;
+	float dy;
+
+	// first order guess at how far the value is from 0, e.g. how far a land value is from the coast
+	float DistanceToZero() const;
+};
+
+GridSample SampleBilinear(const float* grid, int width, int height, float x, float y);
@@ -0,0 +1,207 @@
+#include "Labels.h"
+
+#include <chrono>
+
+int labelFontSize = 10;
+float labelGap = 3.0f;
+float labelGridSize = 32.0f;
+float legendClearance = 30.0f;
+float routeLabelStops[] = { 0.5f, 0.35f, 0.65f, 0.2f, 0.8f };
+
+Labels::Labels(CurveTerrain& terrain, Landmarks& landmarksRef, Paths& pathsRef, Legend& legendRef)
+	: terrain(terrain)
+	, landmarksRef(landmarksRef)
+	, pathsRef(pathsRef)
+	, legendRef(legendRef)
+{
+	DependsOn(&terrain);
+	DependsOn(&landmarksRef);
+	DependsOn(&pathsRef);
+	DependsOn(&legendRef);
+}
+
+Labels::~Labels()
+{
+}
+
+void Labels::Setup()
+{
+	font.loadFont("../ManicMondayBold.otf", labelFontSize);
+
+	Reset();
+}
+
+void Labels::Reset()
+{
+	labels.clear();
+	grid.Setup(ofGetWidth(), ofGetHeight(), labelGridSize);
+
+	if (image.isAllocated())
+		image.clear();
+	image.allocate(ofGetWidth(), ofGetHeight(), GL_RGBA);
+	image.begin();
+	ofClear(0, 0, 0, 0);
+	image.end();
+}
+
+void Labels::AddObstacles()
+{
+	const vector<Landmarks::Landmark>& landmarksIn = landmarksRef.GetLandmarks();
+	for (auto& landmark : landmarksIn)
+	{
+		grid.AddRect(landmark.bounds);
+	}
+
+	// owned by their index, so a route's own label can sit right beside it
+	const vector<ofPolyline>& routes = pathsRef.GetDrawnPaths();
+	for (int i = 0; i < routes.size(); i++)
+	{
+		grid.AddPolyline(routes[i], i);
+	}
+
+	for (auto& coast : terrain.GetCoastlines())
+	{
+		grid.AddPolyline(coast);
+	}
+
+	// the paper drawn behind the legend sticks out past its bounds
+	ofRectangle legendBounds = legendRef.GetBounds();
+	legendBounds.translate(-legendClearance, -legendClearance);
+	legendBounds.setWidth(legendBounds.getWidth() + legendClearance * 2);
+	legendBounds.setHeight(legendBounds.getHeight() + legendClearance * 2);
+	grid.AddRect(legendBounds);
+}
+
+bool Labels::TryPlace(const std::string& text, const ofRectangle& textBox, ofPoint corner, int ignoreOwner)
+{
+	ofRectangle bounds(corner, textBox.getWidth(), textBox.getHeight());
+	if (bounds.getMinX() < 0 || bounds.getMinY() < 0 || bounds.getMaxX() > ofGetWidth() || bounds.getMaxY() > ofGetHeight())
+		return false;
+
+	if (grid.Overlaps(bounds, ignoreOwner))
+		return false;
+
+	grid.AddRect(bounds);
+	labels.push_back(Label{ text, bounds, corner - textBox.getPosition() });
+	return true;
+}
+
+bool Labels::PlaceLandmarkLabel(const std::string& text, ofRectangle icon)
+{
+	ofRectangle textBox = font.getStringBoundingBox(text, 0, 0);
+	float w = textBox.getWidth();
+	float h = textBox.getHeight();
+	float midX = icon.getCenter().x - w / 2;
+	float midY = icon.getCenter().y - h / 2;
+
+	// in order of preference
+	ofPoint candidates[] = {
+		ofPoint(icon.getMaxX() + labelGap, midY),
+		ofPoint(icon.getMinX() - labelGap - w, midY),
+		ofPoint(midX, icon.getMinY() - labelGap - h),
+		ofPoint(midX, icon.getMaxY() + labelGap),
+		ofPoint(icon.getMaxX() + labelGap, icon.getMinY() - h),
+		ofPoint(icon.getMaxX() + labelGap, icon.getMaxY()),
+		ofPoint(icon.getMinX() - labelGap - w, icon.getMinY() - h),
+		ofPoint(icon.getMinX() - labelGap - w, icon.getMaxY()),
+	};
+
+	for (auto corner : candidates)
+	{
+		if (TryPlace(text, textBox, corner))
+			return true;
+	}
+	return false;
+}
+
+// Beside the route rather than over it: pushed out along the route's normal until the box just
+// clears the line, on one side then the other. The route's own segments are ignored, since the
+// box would otherwise touch them wherever the route isn't level.
+bool Labels::PlaceRouteLabel(const std::string& text, const ofPolyline& route, int routeIdx)
+{
+	if (route.size() < 2)
+		return false;
+
+	ofRectangle textBox = font.getStringBoundingBox(text, 0, 0);
+	float w = textBox.getWidth();
+	float h = textBox.getHeight();
+	float length = route.getPerimeter();
+
+	for (float stop : routeLabelStops)
+	{
+		float along = length * stop;
+		ofPoint pt = route.getPointAtLength(along);
+
+		// the direction over the label's width, so the rough drawing's wobble doesn't swing it
+		ofPoint tangent = route.getPointAtLength(std::min(length, along + w / 2))
+			- route.getPointAtLength(std::max(0.0f, along - w / 2));
+		ofPoint normal = tangent.length() > 0 ? ofPoint(tangent.y, -tangent.x).getNormalized() : ofPoint(0, -1);
+		// upwards first, as level routes always were
+		if (normal.y > 0)
+			normal = -normal;
+		float extent = std::abs(normal.x) * w / 2 + std::abs(normal.y) * h / 2;
+
+		for (float side : { 1.0f, -1.0f })
+		{
+			ofPoint centre = pt + normal * side * (extent + labelGap);
+			if (TryPlace(text, textBox, ofPoint(centre.x - w / 2, centre.y - h / 2), routeIdx))
+				return true;
+		}
+	}
+	return false;
+}
+
+bool Labels::Render()
+{
+	std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+	labels.clear();
+	grid.Clear();
+	AddObstacles();
+
+	int tried = 0;
+
+	const vector<Landmarks::Landmark>& landmarksIn = landmarksRef.GetLandmarks();
+	for (auto& landmark : landmarksIn)
+	{
+		std::string name = legendRef.GetLandmarkName(landmark.iconIdx);
+		if (name.empty())
+			continue;
+
+		tried++;
+		PlaceLandmarkLabel(name, landmark.bounds);
+	}
+
+	const vector<ofPolyline>& routes = pathsRef.GetDrawnPaths();
+	for (int i = 0; i < routes.size(); i++)
+	{
+		std::string name = legendRef.GetPathName(pathsRef.GetPathStyle(i));
+		if (name.empty())
+			continue;
+
+		tried++;
+		PlaceRouteLabel(name, routes[i], i);
+	}
+
+	float elapsed = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+	printf("Placed %d of %d labels in %.2fms\n", (int)labels.size(), tried, elapsed);
+
+	image.begin();
+	ofClear(0, 0, 0, 0);
+
+	ofSetColor(ofColor::black);
+	ofEnableSmoothing();
+	for (auto& label : labels)
+	{
+		font.drawString(label.text, label.baseline.x, label.baseline.y);
+	}
+
+	image.end();
+	return true;
+}
+
+void Labels::Draw()
+{
+	if(image.isAllocated())
+		image.draw(0, 0);
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include "Stage.h"
+#include "ofMain.h"
+
+#include "CurveTerrain.h"
+#include "Landmarks.h"
+#include "Paths.h"
+#include "Legend.h"
+#include "SpatialGrid.h"
+
+class Labels : public Stage
+{
+public:
+	Labels(CurveTerrain& terrain, Landmarks& landmarksRef, Paths& pathsRef, Legend& legendRef);
+	~Labels();
+
+	virtual void Setup();
+	virtual bool Render();
+	virtual void Draw();
+	virtual void Reset();
+
+	struct Label {
+		std::string text;
+		ofRectangle bounds;
+		ofPoint baseline;
+	};
+
+private:
+	CurveTerrain& terrain;
+	Landmarks& landmarksRef;
+	Paths& pathsRef;
+	Legend& legendRef;
+
+	void AddObstacles();
+	bool PlaceLandmarkLabel(const std::string& text, ofRectangle icon);
+	bool PlaceRouteLabel(const std::string& text, const ofPolyline& route, int routeIdx);
+	bool TryPlace(const std::string& text, const ofRectangle& textBox, ofPoint corner, int ignoreOwner = SpatialGrid::noOwner);
+
+	SpatialGrid grid;
+	vector<Label> labels;
+	ofTrueTypeFont font;
+
+	ofFbo image;
+};
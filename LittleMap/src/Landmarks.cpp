@@ -1,14 +1,17 @@
 #include "Landmarks.h"
+#include "Snapshot.h"
 
 float placementGridSize = 160.0f;
 float avoidRadiusLand = 40.0f;
 float avoidRadiusWater = 150.0f;
-float shorelineNoiseAvoid = 0.10f;
+float shoreClearance = 40.0f;
 float iconScale = 0.5f;
 
-Landmarks::Landmarks(CurveTerrain &terrain)
-	: terrain(terrain)
+Landmarks::Landmarks(Generator &generator, CurveTerrain &terrain)
+	: generator(generator)
+	, terrain(terrain)
 {
+	DependsOn(&terrain);
 }
 
 Landmarks::~Landmarks()
@@ -54,10 +57,10 @@ void Landmarks::Reset()
 	image.end();
 }
 
-bool Landmarks::Render()
+// Placement only reads the terrain, so it runs on the worker; Render draws the icons.
+bool Landmarks::Generate()
 {
-	image.begin();
-	ofClear(0, 0, 0, 0);
+	rng = generator.GetStream(Generator::StreamLandmarks);
 
 	printf("Placing landmarks\n");
 
@@ -67,17 +70,17 @@ bool Landmarks::Render()
 		for (int x = 0; x < ofGetWidth(); x += placementGridSize)
 		{
 			Landmark landmark;
-			landmark.iconIdx = std::rand() % icons.size();
+			landmark.iconIdx = rng.Int(icons.size());
 			bool found = false;
 			for (int attempt = 0; attempt < 10; attempt++)
 			{
-				ofPoint pt = ofPoint(ofRandom(placementGridSize), ofRandom(placementGridSize))
+				ofPoint pt = ofPoint(rng.Range(placementGridSize), rng.Range(placementGridSize))
 					+ ofPoint(x, y);
 
-				float onLand = terrain.GetLandValue(pt.x, pt.y);
+				float onLand = terrain.SampleLand(pt.x, pt.y).value;
 
-				// keep a way from shore, cheap way
-				if (onLand > -shorelineNoiseAvoid && onLand < shorelineNoiseAvoid)
+				// keep away from shore
+				if (std::abs(terrain.GetShoreDistance(pt.x, pt.y)) < shoreClearance)
 					continue;
 
 				found = true;
@@ -102,11 +105,18 @@ bool Landmarks::Render()
 			}
 		}
 	}
+	return true;
+}
+
+bool Landmarks::Render()
+{
+	image.begin();
+	ofClear(0, 0, 0, 0);
 
 	ofEnableAlphaBlending();
 	for (int i = 0; i < landmarks.size(); i++)
 	{
-		Landmark landmark = landmarks[i];
+		Landmark &landmark = landmarks[i];
 		if (landmark.onLand > 0)
 		{
 			ofSetColor(255, 255, 255, 255);
@@ -118,7 +128,7 @@ bool Landmarks::Render()
 			ofSetColor(255, 255, 255, 150);
 		}
 
-		DrawIcon(landmark.iconIdx, landmark.pos);
+		landmark.bounds = DrawIcon(landmark.iconIdx, landmark.pos);
 	}
 	ofDisableAlphaBlending();
 
@@ -127,6 +137,92 @@ bool Landmarks::Render()
 	return true;
 }
 
+// bounds come from the icons, so Render works them out again
+bool Landmarks::WriteSnapshot(SnapshotWriter& out)
+{
+	out.Write((int)landmarks.size());
+	for (auto& landmark : landmarks)
+	{
+		out.Write(landmark.pos);
+		out.Write(landmark.iconIdx);
+		out.Write(landmark.onLand);
+	}
+	return true;
+}
+
+bool Landmarks::ReadSnapshot(SnapshotReader& in)
+{
+	int count;
+	if (!in.ReadCount(count, sizeof(ofPoint) + sizeof(int) + sizeof(float)))
+		return false;
+
+	landmarks.resize(count);
+	for (auto& landmark : landmarks)
+	{
+		if (!in.Read(landmark.pos) || !in.Read(landmark.iconIdx) || !in.Read(landmark.onLand))
+			return false;
+		// icons may have changed since
+		if (landmark.iconIdx < 0 || landmark.iconIdx >= icons.size())
+			return false;
+	}
+	return true;
+}
+
+void Landmarks::BlendIcon(int idx, ofPoint pt, float alpha, ofPixels& target, ofPoint origin, float zoom) const
+{
+	const ofPixels& icon = icons[idx].getPixels();
+	int channels = icon.getNumChannels();
+	int targetChannels = target.getNumChannels();
+	if (icon.getWidth() == 0 || channels < 3)
+		return;
+
+	// icon pixels per target pixel
+	float step = zoom / iconScale;
+	float width = icon.getWidth() / step;
+	float height = icon.getHeight() / step;
+	ofPoint corner = (pt - origin) / zoom - ofPoint(width / 2, height / 2);
+
+	int x0 = std::max(0, (int)std::floor(corner.x));
+	int y0 = std::max(0, (int)std::floor(corner.y));
+	int x1 = std::min((int)target.getWidth(), (int)std::ceil(corner.x + width));
+	int y1 = std::min((int)target.getHeight(), (int)std::ceil(corner.y + height));
+	for (int y = y0; y < y1; y++)
+	{
+		for (int x = x0; x < x1; x++)
+		{
+			// box filter over the icon pixels under this one
+			int sx0 = std::max(0, (int)((x - corner.x) * step));
+			int sy0 = std::max(0, (int)((y - corner.y) * step));
+			int sx1 = std::min((int)icon.getWidth(), std::max(sx0 + 1, (int)((x + 1 - corner.x) * step)));
+			int sy1 = std::min((int)icon.getHeight(), std::max(sy0 + 1, (int)((y + 1 - corner.y) * step)));
+			float sum[4] = { 0, 0, 0, 0 };
+			int count = 0;
+			for (int sy = sy0; sy < sy1; sy++)
+			{
+				for (int sx = sx0; sx < sx1; sx++)
+				{
+					const unsigned char* src = &icon.getData()[(sy * icon.getWidth() + sx) * channels];
+					float a = channels == 4 ? src[3] : 255;
+					for (int c = 0; c < 3; c++)
+						sum[c] += src[c] * a;
+					sum[3] += a;
+					count++;
+				}
+			}
+			if (count == 0 || sum[3] == 0)
+				continue;
+
+			float coverage = (sum[3] / count / 255) * (alpha / 255);
+			unsigned char* dest = &target.getData()[(y * target.getWidth() + x) * targetChannels];
+			for (int c = 0; c < 3; c++)
+			{
+				float colour = sum[c] / sum[3];
+				dest[c] = (unsigned char)(dest[c] + (colour - dest[c]) * coverage);
+			}
+		}
+	}
+}
+
 ofRectangle Landmarks::DrawIcon(int idx, ofPoint pt)
 {
 	ofImage icon = icons[idx];
@@ -142,14 +238,29 @@ void Landmarks::Draw()
 		image.draw(0, 0);
 }
 
-const vector<Landmarks::Landmark> Landmarks::GetLandmarks()
+// the icons themselves, rather than the image of them shrunk
+void Landmarks::DrawLevel(float scale)
+{
+	ofPushMatrix();
+	ofScale(scale, scale);
+	ofEnableAlphaBlending();
+	for (auto& landmark : landmarks)
+	{
+		ofSetColor(255, 255, 255, landmark.onLand > 0 ? 255 : 150);
+		DrawIcon(landmark.iconIdx, landmark.pos);
+	}
+	ofDisableAlphaBlending();
+	ofPopMatrix();
+}
+
+const vector<Landmarks::Landmark>& Landmarks::GetLandmarks()
 {
 	return landmarks;
 }
 
-Landmarks::Landmark Landmarks::GetRandomLandmark()
+Landmarks::Landmark Landmarks::GetRandomLandmark(Random &rng)
 {
-	int r = std::rand() % landmarks.size();
+	int r = rng.Int(landmarks.size());
 	return landmarks[r];
 }
 
@@ -170,7 +281,8 @@ public:
 
 Landmarks::Landmark Landmarks::GetNthClosestLandmark(Landmark target, int n)
 {
-	vector<Landmark> close = vector<Landmark>(landmarks);
+	vector<Landmark>& close = closeScratch;
+	close.assign(landmarks.begin(), landmarks.end());
 	DistanceSort sorter = DistanceSort(target);
 	std::sort(close.begin(), close.end(), sorter);
 	printf("About to look for the %dth landmark.\n", n);
@@ -3,37 +3,57 @@
 #include "Stage.h"
 
 #include "CurveTerrain.h"
+#include "Generator.h"
 
 #include <vector>
 
+// Placement tuning, which World's chunks follow too.
+extern float avoidRadiusLand;
+extern float avoidRadiusWater;
+// pixels from the nearest coast
+extern float shoreClearance;
+
 class Landmarks : public Stage
 {
 public:
-	Landmarks(CurveTerrain &terrain);
+	Landmarks(Generator &generator, CurveTerrain &terrain);
 	~Landmarks();
 
 	virtual void Setup();
+	virtual bool Generate();
 	virtual bool Render();
 	virtual void Draw();
+	virtual void DrawLevel(float scale);
 	virtual void Reset();
+	virtual bool WriteSnapshot(SnapshotWriter& out);
+	virtual bool ReadSnapshot(SnapshotReader& in);
 
 	struct Landmark {
 		ofPoint pos;
 		int iconIdx;
 		float onLand;
+		ofRectangle bounds;
 	};
 
-	const vector<Landmark> GetLandmarks();
+	const vector<Landmark>& GetLandmarks();
 	ofRectangle DrawIcon(int idx, ofPoint pt);
-	Landmark GetRandomLandmark();
+	int GetIconCount() { return icons.size(); }
+	// DrawIcon without GL, for drawing off the main thread. target's top left is at origin,
+	// and it's zoomed out by zoom; alpha is 0-255 like ofSetColor's.
+	void BlendIcon(int idx, ofPoint pt, float alpha, ofPixels& target, ofPoint origin, float zoom) const;
+	Landmark GetRandomLandmark(Random &rng);
 	Landmark GetNthClosestLandmark(Landmark landmark, int n);
 
 private:
+	Generator &generator;
+	Random rng;
 	CurveTerrain &terrain;
 
 	vector<ofFile> files;
 	vector<ofImage> icons;
 	vector<Landmark> landmarks;
+	// reused by GetNthClosestLandmark
+	vector<Landmark> closeScratch;
 
 	ofFbo image;
 };
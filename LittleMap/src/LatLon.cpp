@@ -1,5 +1,4 @@
 #include "LatLon.h"
-#include "Noise.h"
 
 #include "RoughDrawer.h"
 
@@ -7,8 +6,10 @@ const float gridNoiseScale = 0.05f;
 const float gridSpacing = 100.0f;
 const float gridWobble = 10.0f;
 const float gridDetail = 12.0f;
+const NoiseOctaves gridOctaves(3, 0.5f, 0.4f);
 
-LatLon::LatLon()
+LatLon::LatLon(Generator& generator)
+	: generator(generator)
 {
 }
 
@@ -33,11 +34,13 @@ void LatLon::Reset()
 
 float LatLon::LatLonNoise(float x, float y)
 {
-	return Noise(x*gridNoiseScale, y*gridNoiseScale, 3, 0.5f, 0.4f);
+	return generator.Noise(x*gridNoiseScale, y*gridNoiseScale, gridOctaves);
 }
 
 bool LatLon::Render()
 {
+	rng = generator.GetStream(Generator::StreamLatLon);
+
 	image.begin();
 	ofClear(0, 0, 0, 0);
 
@@ -54,7 +57,7 @@ bool LatLon::Render()
 		ofFill();
 		ofSetColor(ofColor::black);
 		ofEnableSmoothing();
-		RoughTracePath(path, 1, 2);
+		RoughTracePath(path, 1, 2, rng);
 	}
 
 	for (int x = 0; x < ofGetWidth(); x += gridSpacing)
@@ -71,7 +74,7 @@ bool LatLon::Render()
 		ofFill();
 		ofSetColor(ofColor::black);
 		ofEnableSmoothing();
-		RoughTracePath(path, 1, 2);
+		RoughTracePath(path, 1, 2, rng);
 	}
 
 	image.end();
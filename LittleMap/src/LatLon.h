@@ -2,10 +2,12 @@
 #include "Stage.h"
 #include "ofMain.h"
 
+#include "Generator.h"
+
 class LatLon : public Stage
 {
 public:
-	LatLon();
+	LatLon(Generator& generator);
 	~LatLon();
 
 	virtual void Setup();
@@ -14,6 +16,9 @@ public:
 	virtual void Reset();
 
 private:
+	Generator& generator;
+	Random rng;
+
 	float LatLonNoise(float x, float y);
 
 	ofFbo image;
@@ -1,6 +1,6 @@
 #include "Legend.h"
-
-#include "Noise.h"
+#include "Snapshot.h"
+#include "Names.h"
 
 int yOffset = 70;
 int ySpacing = 20;
@@ -8,14 +8,16 @@ int xNegOffset = 220;
 int xMargin = 20;
 ofPoint imageOffset(-20, -9);
 int fontSize = 18;
-float adjectiveChance = 0.2f;
-float pathAdjectiveChance = 0.1f;
+const int maxNameLength = 128;
 
 
-Legend::Legend(Landmarks& landmarksRef, Paths& pathsRef)
-	: landmarksRef(landmarksRef)
+Legend::Legend(Generator& generator, Landmarks& landmarksRef, Paths& pathsRef)
+	: generator(generator)
+	, landmarksRef(landmarksRef)
 	, pathsRef(pathsRef)
 {
+	DependsOn(&landmarksRef);
+	DependsOn(&pathsRef);
 }
 
 Legend::~Legend()
@@ -32,68 +34,7 @@ void Legend::Setup()
 void Legend::Reset()
 {
 	landmarks.clear();
-
-	singleNames.clear();
-	singleNames.push_back("TREASURE");
-	singleNames.push_back("HOMETOWN");
-	singleNames.push_back("END OF THE WORLD");
-	singleNames.push_back("NO RETURN");
-	singleNames.push_back("EVIL CASTLE");
-	singleNames.push_back("BEST FRIEND");
-	singleNames.push_back("SWORD OF POWER");
-	singleNames.push_back("MAGIC CRYSTAL");
-	singleNames.push_back("DANGER ZONE");
-	singleNames.push_back("ALTAR");
-	singleNames.push_back("PORTAL");
-	singleNames.push_back("BONUS ZONE");
-	singleNames.push_back("MONOLITH");
-
-	pluralNames.clear();
-	pluralNames.push_back("DEAD END");
-	pluralNames.push_back("VILLAGE");
-	pluralNames.push_back("TOWN");
-	pluralNames.push_back("TAVERN");
-	pluralNames.push_back("CEMETERY");
-	pluralNames.push_back("HOPELESSNESS");
-	pluralNames.push_back("DESPAIR");
-	pluralNames.push_back("TRIBULATIONS");
-	pluralNames.push_back("CAVE");
-	pluralNames.push_back("FOREST");
-	pluralNames.push_back("WRECK");
-	pluralNames.push_back("NPC");
-	pluralNames.push_back("PLACE");
-	pluralNames.push_back("COVEN");
-	pluralNames.push_back("PLURALITY");
-
-	pathNames.clear();
-	pathNames.push_back("ROUTE");
-	pathNames.push_back("PATH");
-	pathNames.push_back("PASSAGE");
-	pathNames.push_back("TUNNEL");
-	pathNames.push_back("VOYAGE");
-	pathNames.push_back("ROAD");
-
-	adjectives.clear();
-	adjectives.push_back("DANK");
-	adjectives.push_back("OLD");
-	adjectives.push_back("SMELLY");
-	adjectives.push_back("HOPELESS");
-	adjectives.push_back("BRIGHT");
-	adjectives.push_back("UNCOUTH");
-	adjectives.push_back("WRETCHED");
-	adjectives.push_back("POTTED");
-	adjectives.push_back("MUDDY");
-	adjectives.push_back("ABANDONED");
-	adjectives.push_back("NEW");
-	adjectives.push_back("HAUNTED");
-	adjectives.push_back("FABLED");
-	adjectives.push_back("LOST");
-	adjectives.push_back("SECRET");
-	adjectives.push_back("PLEASANT");
-	adjectives.push_back("ANCIENT");
-	adjectives.push_back("HIDDEN");
-	adjectives.push_back("DECREPIT");
-	adjectives.push_back("CURSED");
+	keys.clear();
 
 	legendBounds.set(0, 0, 0, 0);
 
@@ -105,53 +46,21 @@ void Legend::Reset()
 	image.end();
 }
 
-std::string Legend::GenerateName(int count)
+std::string Legend::GetLandmarkName(int iconIdx)
 {
-	std::string dest = "";
-	if (count == 1)
-	{
-		int idx = ((int)ofRandom(0, 1000)) % singleNames.size();
-		dest += singleNames[idx];
-	}
-	else
-	{
-		int idx = ((int)ofRandom(0, 1000)) % pluralNames.size();
-		dest += pluralNames[idx];
-	}
-
-	while (ofRandom(0, 1) < adjectiveChance)
-	{
-		int idx = ((int)ofRandom(0, 1000)) % adjectives.size();
-		dest = adjectives[idx] + " " + dest;
-	}
-	return dest;
+	auto it = landmarks.find(iconIdx);
+	if (it == landmarks.end())
+		return "";
+	return it->second.name;
 }
 
-std::string Legend::GeneratePathName(Paths::PathStyle style)
+std::string Legend::GetPathName(Paths::PathStyle style)
 {
-	std::string dest = "";
-	switch(style)
-	{
-	case Paths::PathStyle::Above:
-	case Paths::PathStyle::Below:
-	case Paths::PathStyle::Mixed:
-		{
-			int idx = ((int)ofRandom(0, 1000)) % pathNames.size();
-			dest += pathNames[idx];
-		}
-	}
-
-	{
-		int idx = ((int)ofRandom(0, 1000)) % adjectives.size();
-		dest = adjectives[idx] + " " + dest;
-	}
-
-	while (ofRandom(0, 1) < pathAdjectiveChance)
-	{
-		int idx = ((int)ofRandom(0, 1000)) % adjectives.size();
-		dest = adjectives[idx] + " " + dest;
-	}
-	return dest;
+	// matches the keys Render() draws the route samples for
+	int key = style == Paths::PathStyle::Above ? -1
+			: style == Paths::PathStyle::Below ? -2
+			: -3;
+	return GetLandmarkName(key);
 }
 
 std::string Legend::BreakString(std::string& src, float maxWidth)
@@ -181,9 +90,12 @@ std::string Legend::BreakString(std::string& src, float maxWidth)
 	return dest;
 }
 
-bool Legend::Render()
+// Counts, order and names, off the GL thread. Render lays them out, since that needs the font.
+bool Legend::Generate()
 {
-	const vector<Landmarks::Landmark> landmarksIn = landmarksRef.GetLandmarks();
+	rng = generator.GetStream(Generator::StreamLegend);
+
+	const vector<Landmarks::Landmark>& landmarksIn = landmarksRef.GetLandmarks();
 	for (auto lit : landmarksIn)
 	{
 		if (landmarks.find(lit.iconIdx) == landmarks.end())
@@ -199,24 +111,44 @@ bool Legend::Render()
 	landmarks[-2] = Key{ { ofPoint(), -2, true } };
 	landmarks[-3] = Key{ { ofPoint(), -3, true } };
 
-	image.begin();
-	int current = yOffset;
-	legendBounds.set(ofGetWidth() - xNegOffset, current, 0, 0);
-
-	vector<int> keys;
+	keys.clear();
 	for (auto lit : landmarks)
 	{
 		keys.push_back(lit.first);
 	}
 
-	ofRandomize(keys);
+	rng.Shuffle(keys);
 
-	for(auto key : keys)
+	// each name draws from its own stream, keyed by its key, so it's the same whatever order
+	// or thread names are made in; bends take their draws from rng in key order
+	const NameTable& names = NameTable::Legend();
+	uint64_t nameSeed = generator.GetStreamSeed(Generator::StreamLegend);
+	char name[maxNameLength];
+	for (auto key : keys)
 	{
-		landmarks[key].name = key < 0
-			? GeneratePathName(Paths::PathStyle::Above)
-			: GenerateName(landmarks[key].count);
+		CounterRandom nameRng(nameSeed, (uint64_t)(int64_t)key);
+		int length = key < 0
+			? names.PathName(nameRng, name, maxNameLength)
+			: names.LandmarkName(nameRng, landmarks[key].count, name, maxNameLength);
+		landmarks[key].name.assign(name, length);
+		if (key < 0)
+		{
+			float x = rng.Range(-12.0f, 12.0f);
+			float y = rng.Range(-12.0f, 12.0f);
+			landmarks[key].bend = ofPoint(x, y);
+		}
+	}
+	return true;
+}
 
+bool Legend::Render()
+{
+	image.begin();
+	int current = yOffset;
+	legendBounds.set(ofGetWidth() - xNegOffset, current, 0, 0);
+
+	for(auto key : keys)
+	{
 		ofPoint pos = ofPoint(ofGetWidth() - xNegOffset, current);
 
 		ofSetColor(ofColor::black);
@@ -227,13 +159,13 @@ bool Legend::Render()
 			ofPolyline stroke = ofPolyline();
 			stroke.lineTo(pos + imageOffset + ofPoint(-12, -12));
 			stroke.curveTo(pos + imageOffset + ofPoint(-12, -12));
-			stroke.curveTo(pos + imageOffset + ofPoint(ofRandom(-12.0f, 12.0f), ofRandom(-12.0f, 12.0f)));
+			stroke.curveTo(pos + imageOffset + landmarks[key].bend);
 			stroke.curveTo(pos + imageOffset + ofPoint(12, 12));
 			stroke.curveTo(pos + imageOffset + ofPoint(12, 12));
 			Paths::PathStyle style = key == -1 ? Paths::PathStyle::Above
 									: key == -2 ? Paths::PathStyle::Below
 									: Paths::PathStyle::Mixed;
-			pathsRef.DrawRoute(stroke, style, false);
+			pathsRef.DrawRoute(stroke, style, nullptr);
 		}
 		else
 		{
@@ -253,6 +185,42 @@ bool Legend::Render()
 	return true;
 }
 
+bool Legend::WriteSnapshot(SnapshotWriter& out)
+{
+	out.Write((int)keys.size());
+	for (auto key : keys)
+	{
+		Key& k = landmarks[key];
+		out.Write(key);
+		out.Write(k.count);
+		out.WriteString(k.name);
+		out.Write(k.bend);
+	}
+	return true;
+}
+
+bool Legend::ReadSnapshot(SnapshotReader& in)
+{
+	int count;
+	if (!in.ReadCount(count, sizeof(int) * 2 + SnapshotReader::minStringBytes + sizeof(ofPoint)))
+		return false;
+
+	landmarks.clear();
+	keys.resize(count);
+	for (auto& key : keys)
+	{
+		Key k{ { ofPoint(), 0, true } };
+		if (!in.Read(key) || !in.Read(k.count) || !in.ReadString(k.name) || !in.Read(k.bend))
+			return false;
+		// an icon, or one of the three route keys, and each only once; icons may have changed since
+		if (key < -3 || key >= landmarksRef.GetIconCount() || landmarks.count(key) > 0)
+			return false;
+		k.landmark.iconIdx = key;
+		landmarks[key] = k;
+	}
+	return true;
+}
+
 void Legend::Draw()
 {
 	if(image.isAllocated())
@@ -4,40 +4,45 @@
 
 #include "Landmarks.h"
 #include "Paths.h"
+#include "Generator.h"
 
 class Legend : public Stage
 {
 public:
-	Legend(Landmarks& landmarksRef, Paths& pathsRef);
+	Legend(Generator& generator, Landmarks& landmarksRef, Paths& pathsRef);
 	~Legend();
 
 	virtual void Setup();
+	virtual bool Generate();
 	virtual bool Render();
 	virtual void Draw();
 	virtual void Reset();
+	virtual bool WriteSnapshot(SnapshotWriter& out);
+	virtual bool ReadSnapshot(SnapshotReader& in);
 
 	struct Key {
 		Landmarks::Landmark landmark;
 		int count;
 		std::string name;
+		// where the sample stroke for a route key bends
+		ofPoint bend;
 	};
 
 	ofRectangle GetBounds() { return legendBounds; }
+	std::string GetLandmarkName(int iconIdx);
+	std::string GetPathName(Paths::PathStyle style);
 
 private:
+	Generator& generator;
+	Random rng;
 	Landmarks& landmarksRef;
 	Paths& pathsRef;
 
 	std::string BreakString(std::string& srd, float maxWidth);
-	std::string GenerateName(int count);
-	std::string GeneratePathName(Paths::PathStyle style);
-
-	vector<std::string> singleNames;
-	vector<std::string> pluralNames;
-	vector<std::string> pathNames;
-	vector<std::string> adjectives;
 
 	map<int, Key> landmarks;
+	// keys in the order they're listed
+	vector<int> keys;
 	ofTrueTypeFont font;
 
 	ofRectangle legendBounds;
@@ -0,0 +1,166 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include <cstring>
+
+// Windows start on a multiple of windowSize, which is a multiple of the allocation
+// granularity everywhere, and run on by windowOverlap so a read across the boundary still fits.
+const uint64_t windowSize = 64 * 1024 * 1024;
+const uint64_t windowOverlap = 64 * 1024;
+
+MappedFile::MappedFile()
+	: opened(false)
+	, size(0)
+	, window(nullptr)
+	, windowStart(0)
+	, windowLength(0)
+#ifdef _WIN32
+	, file(INVALID_HANDLE_VALUE)
+	, mapping(nullptr)
+#else
+	, file(-1)
+#endif
+{
+}
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+bool MappedFile::Open(const std::string& path)
+{
+	Close();
+
+#ifdef _WIN32
+	file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+	{
+		Close();
+		return false;
+	}
+	size = (uint64_t)fileSize.QuadPart;
+
+	mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mapping == nullptr)
+	{
+		Close();
+		return false;
+	}
+#else
+	file = open(path.c_str(), O_RDONLY);
+	if (file < 0)
+		return false;
+
+	struct stat info;
+	if (fstat(file, &info) != 0 || info.st_size == 0)
+	{
+		Close();
+		return false;
+	}
+	size = (uint64_t)info.st_size;
+#endif
+
+	// the first window has the headers in it, and a file that can't map that can't map anything
+	opened = true;
+	if (!MapWindow(0, std::min(windowSize + windowOverlap, size)))
+	{
+		Close();
+		return false;
+	}
+	return true;
+}
+
+void MappedFile::Close()
+{
+	UnmapWindow();
+#ifdef _WIN32
+	if (mapping != nullptr)
+		CloseHandle(mapping);
+	if (file != INVALID_HANDLE_VALUE)
+		CloseHandle(file);
+	mapping = nullptr;
+	file = INVALID_HANDLE_VALUE;
+#else
+	if (file >= 0)
+		close(file);
+	file = -1;
+#endif
+	opened = false;
+	size = 0;
+}
+
+bool MappedFile::Read(uint64_t offset, void* out, size_t length) const
+{
+	if (!opened || length > windowOverlap || offset > size || size - offset < length)
+		return false;
+
+	if (window == nullptr || offset < windowStart || offset - windowStart + length > windowLength)
+	{
+		uint64_t start = offset - offset % windowSize;
+		if (!MapWindow(start, std::min(windowSize + windowOverlap, size - start)))
+			return false;
+	}
+	memcpy(out, window + (offset - windowStart), length);
+	return true;
+}
+
+const char* MappedFile::GetData() const
+{
+	if (!opened || size > SIZE_MAX)
+		return nullptr;
+	if (window == nullptr || windowStart != 0 || windowLength != size)
+	{
+		if (!MapWindow(0, size))
+			return nullptr;
+	}
+	return window;
+}
+
+bool MappedFile::MapWindow(uint64_t start, uint64_t length) const
+{
+	UnmapWindow();
+	windowLength = (size_t)length;
+
+#ifdef _WIN32
+	window = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, (DWORD)(start >> 32), (DWORD)start, windowLength);
+#else
+	void* view = mmap(nullptr, windowLength, PROT_READ, MAP_PRIVATE, file, (off_t)start);
+	window = view == MAP_FAILED ? nullptr : (const char*)view;
+#endif
+
+	if (window == nullptr)
+	{
+		windowLength = 0;
+		return false;
+	}
+	windowStart = start;
+	return true;
+}
+
+void MappedFile::UnmapWindow() const
+{
+	if (window == nullptr)
+		return;
+#ifdef _WIN32
+	UnmapViewOfFile(window);
+#else
+	munmap((void*)window, windowLength);
+#endif
+	window = nullptr;
+	windowStart = 0;
+	windowLength = 0;
+}
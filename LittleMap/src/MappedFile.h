@@ -0,0 +1,48 @@
+#pragma once
+#include "ofMain.h"
+
+#include <stdint.h>
+
+// A file mapped read only into memory a window at a time, so reading it back costs no more
+// than touching the pages actually used, and a file bigger than the address space still works
+// in a 32 bit build.
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+
+	bool Open(const std::string& path);
+	void Close();
+
+	bool IsOpen() const { return opened; }
+	uint64_t GetSize() const { return size; }
+
+	// Copies length bytes from offset into out, mapping that part of the file in first if the
+	// current window doesn't have it. False if any of it is past the end, or length is more
+	// than the overlap between windows.
+	bool Read(uint64_t offset, void* out, size_t length) const;
+	// The whole file in one window, for files small enough to read straight through, or null
+	// if it won't fit in the address space. Good until Close, or a Read outside it.
+	const char* GetData() const;
+
+private:
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool MapWindow(uint64_t start, uint64_t length) const;
+	void UnmapWindow() const;
+
+	bool opened;
+	uint64_t size;
+	// moved by Read, so const readers can share one
+	mutable const char* window;
+	mutable uint64_t windowStart;
+	mutable size_t windowLength;
+#ifdef _WIN32
+	void* file;
+	void* mapping;
+#else
+	int file;
+#endif
+};
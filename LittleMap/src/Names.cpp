@@ -0,0 +1,103 @@
+#include "Names.h"
+
+#include <cstring>
+
+float adjectiveChance = 0.2f;
+float pathAdjectiveChance = 0.1f;
+// more adjectives than this are never drawn, a 1 in millions chance anyway
+const int maxAdjectives = 8;
+
+static const char* const singleWords[] = {
+	"TREASURE", "HOMETOWN", "END OF THE WORLD", "NO RETURN", "EVIL CASTLE", "BEST FRIEND",
+	"SWORD OF POWER", "MAGIC CRYSTAL", "DANGER ZONE", "ALTAR", "PORTAL", "BONUS ZONE", "MONOLITH",
+};
+static const char* const pluralWords[] = {
+	"DEAD END", "VILLAGE", "TOWN", "TAVERN", "CEMETERY", "HOPELESSNESS", "DESPAIR", "TRIBULATIONS",
+	"CAVE", "FOREST", "WRECK", "NPC", "PLACE", "COVEN", "PLURALITY",
+};
+static const char* const pathWords[] = {
+	"ROUTE", "PATH", "PASSAGE", "TUNNEL", "VOYAGE", "ROAD",
+};
+static const char* const adjectiveWords[] = {
+	"DANK", "OLD", "SMELLY", "HOPELESS", "BRIGHT", "UNCOUTH", "WRETCHED", "POTTED", "MUDDY", "ABANDONED",
+	"NEW", "HAUNTED", "FABLED", "LOST", "SECRET", "PLEASANT", "ANCIENT", "HIDDEN", "DECREPIT", "CURSED",
+};
+
+const NameTable& NameTable::Legend()
+{
+	static const NameTable table;
+	return table;
+}
+
+NameTable::NameTable()
+{
+	AddWords(singleNames, singleWords, sizeof(singleWords) / sizeof(singleWords[0]));
+	AddWords(pluralNames, pluralWords, sizeof(pluralWords) / sizeof(pluralWords[0]));
+	AddWords(pathNames, pathWords, sizeof(pathWords) / sizeof(pathWords[0]));
+	AddWords(adjectives, adjectiveWords, sizeof(adjectiveWords) / sizeof(adjectiveWords[0]));
+}
+
+int NameTable::Intern(const char* word)
+{
+	for (int i = 0; i < words.size(); i++)
+	{
+		if (strcmp(&text[words[i].offset], word) == 0)
+			return i;
+	}
+
+	int length = strlen(word);
+	words.push_back(Word{ (int)text.size(), length });
+	text.insert(text.end(), word, word + length + 1);
+	return words.size() - 1;
+}
+
+void NameTable::AddWords(vector<int>& list, const char* const* newWords, int count)
+{
+	for (int i = 0; i < count; i++)
+		list.push_back(Intern(newWords[i]));
+}
+
+int NameTable::DrawAdjectives(CounterRandom& rng, float chance, int* drawn, int max) const
+{
+	int count = 0;
+	while (count < max && rng.Float() < chance)
+		drawn[count++] = adjectives[rng.Int(adjectives.size())];
+	return count;
+}
+
+int NameTable::Write(const int* adjectiveList, int adjectiveCount, int noun, char* out, int size) const
+{
+	int length = 0;
+	for (int i = adjectiveCount; i >= 0; i--)
+	{
+		const Word& word = words[i == 0 ? noun : adjectiveList[i - 1]];
+		if (length > 0 && length < size - 1)
+			out[length++] = ' ';
+		int copy = std::min(word.length, size - 1 - length);
+		memcpy(out + length, &text[word.offset], copy);
+		length += copy;
+	}
+	out[length] = 0;
+	return length;
+}
+
+int NameTable::LandmarkName(CounterRandom& rng, int count, char* out, int size) const
+{
+	const vector<int>& nouns = count == 1 ? singleNames : pluralNames;
+	int noun = nouns[rng.Int(nouns.size())];
+
+	int drawn[maxAdjectives];
+	int adjectiveCount = DrawAdjectives(rng, adjectiveChance, drawn, maxAdjectives);
+	return Write(drawn, adjectiveCount, noun, out, size);
+}
+
+int NameTable::PathName(CounterRandom& rng, char* out, int size) const
+{
+	int noun = pathNames[rng.Int(pathNames.size())];
+
+	// always one, then maybe more
+	int drawn[maxAdjectives];
+	drawn[0] = adjectives[rng.Int(adjectives.size())];
+	int adjectiveCount = 1 + DrawAdjectives(rng, pathAdjectiveChance, drawn + 1, maxAdjectives - 1);
+	return Write(drawn, adjectiveCount, noun, out, size);
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include "ofMain.h"
+#include "Random.h"
+
+#include <vector>
+
+// Word lists for legend names. Every word is stored once, back to back in one buffer, and the
+// lists are just word numbers. Built once and never changed after, so any number of threads can
+// make names from the same table at the same time.
+class NameTable
+{
+public:
+	// the legend's words
+	static const NameTable& Legend();
+
+	// Both write the name into out, always terminated and cut short if it doesn't fit, and
+	// return its length. Nothing is allocated.
+	int LandmarkName(CounterRandom& rng, int count, char* out, int size) const;
+	int PathName(CounterRandom& rng, char* out, int size) const;
+
+private:
+	NameTable();
+
+	struct Word {
+		int offset;
+		int length;
+	};
+
+	int Intern(const char* word);
+	void AddWords(vector<int>& list, const char* const* words, int count);
+	// the adjectives go on in front, the last one drawn first, as if each was prepended
+	int Write(const int* adjectiveList, int adjectiveCount, int noun, char* out, int size) const;
+	int DrawAdjectives(CounterRandom& rng, float chance, int* drawn, int max) const;
+
+	vector<char> text;
+	vector<Word> words;
+
+	vector<int> singleNames;
+	vector<int> pluralNames;
+	vector<int> pathNames;
+	vector<int> adjectives;
+};
@@ -0,0 +1,323 @@
+#include "NavGraph.h"
+
+#include <queue>
+#include <chrono>
+#include <cfloat>
+
+// a border is split into stretches of this many nodes, with a portal at the cheapest crossing of each
+int portalStretch = 4;
+
+NavGraph::NavGraph()
+	: latticeWidth(0)
+	, latticeHeight(0)
+	, spacing(1)
+	, clusterNodes(1)
+	, clustersX(0)
+	, clustersY(0)
+{
+}
+
+NavGraph::~NavGraph()
+{
+}
+
+void NavGraph::Clear()
+{
+	portals.clear();
+	edges.clear();
+	clusterPortals.clear();
+	penalty.clear();
+}
+
+int NavGraph::NodeAt(ofPoint pos) const
+{
+	int x = ofClamp((int)std::round(pos.x / spacing), 0, latticeWidth - 1);
+	int y = ofClamp((int)std::round(pos.y / spacing), 0, latticeHeight - 1);
+	return x + y * latticeWidth;
+}
+
+int NavGraph::ClusterOf(int node) const
+{
+	int cx = (node % latticeWidth) / clusterNodes;
+	int cy = (node / latticeWidth) / clusterNodes;
+	return cx + cy * clustersX;
+}
+
+ofPoint NavGraph::NodePos(int node) const
+{
+	return ofPoint(node % latticeWidth, node / latticeWidth) * spacing;
+}
+
+int NavGraph::AddPortal(int node, int cluster)
+{
+	portals.push_back(Portal{ node, cluster, NodePos(node) });
+	edges.push_back(vector<Edge>());
+	clusterPortals[cluster].push_back(portals.size() - 1);
+	return portals.size() - 1;
+}
+
+void NavGraph::Build(int latticeWidth, int latticeHeight, float spacing, int clusterNodes, const vector<float>& penalty)
+{
+	std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+	Clear();
+	this->latticeWidth = latticeWidth;
+	this->latticeHeight = latticeHeight;
+	this->spacing = spacing;
+	this->clusterNodes = clusterNodes;
+	this->penalty = penalty;
+	clustersX = (latticeWidth + clusterNodes - 1) / clusterNodes;
+	clustersY = (latticeHeight + clusterNodes - 1) / clusterNodes;
+	clusterPortals.resize(clustersX * clustersY);
+
+	// portals across each vertical border (dir 0) and horizontal border (dir 1)
+	for (int dir = 0; dir < 2; dir++)
+	{
+		for (int cy = 0; cy < clustersY; cy++)
+		{
+			for (int cx = 0; cx < clustersX; cx++)
+			{
+				if ((dir == 0 && cx + 1 >= clustersX) || (dir == 1 && cy + 1 >= clustersY))
+					continue;
+
+				int cluster = cx + cy * clustersX;
+				int neighbour = dir == 0 ? cluster + 1 : cluster + clustersX;
+				int first = dir == 0 ? cy * clusterNodes : cx * clusterNodes;
+				int last = std::min(first + clusterNodes, dir == 0 ? latticeHeight : latticeWidth);
+
+				for (int stretch = first; stretch < last; stretch += portalStretch)
+				{
+					int best = -1;
+					float bestPenalty = FLT_MAX;
+					for (int i = stretch; i < std::min(stretch + portalStretch, last); i++)
+					{
+						int inside = dir == 0
+							? ((cx + 1) * clusterNodes - 1) + i * latticeWidth
+							: i + ((cy + 1) * clusterNodes - 1) * latticeWidth;
+						int outside = dir == 0 ? inside + 1 : inside + latticeWidth;
+						float crossing = penalty[inside] + penalty[outside];
+						if (crossing < bestPenalty)
+						{
+							bestPenalty = crossing;
+							best = inside;
+						}
+					}
+
+					int outside = dir == 0 ? best + 1 : best + latticeWidth;
+					int a = AddPortal(best, cluster);
+					int b = AddPortal(outside, neighbour);
+					float cost = spacing * (1.0f + bestPenalty * 0.5f);
+					edges[a].push_back(Edge{ b, cost });
+					edges[b].push_back(Edge{ a, cost });
+				}
+			}
+		}
+	}
+
+	searchCost.assign(latticeWidth * latticeHeight, FLT_MAX);
+	searchTouched.clear();
+	for (int cluster = 0; cluster < clusterPortals.size(); cluster++)
+	{
+		LinkPortals(cluster);
+	}
+
+	float elapsed = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+	printf("Built nav graph: %d clusters, %d portals in %.2fms\n", (int)clusterPortals.size(), (int)portals.size(), elapsed);
+}
+
+void NavGraph::ClusterSearch(int cluster, int source, vector<float>& cost)
+{
+	// reset only what the last search touched
+	for (int node : searchTouched)
+		cost[node] = FLT_MAX;
+	searchTouched.clear();
+
+	int x0 = (cluster % clustersX) * clusterNodes;
+	int y0 = (cluster / clustersX) * clusterNodes;
+	int x1 = std::min(x0 + clusterNodes, latticeWidth);
+	int y1 = std::min(y0 + clusterNodes, latticeHeight);
+
+	typedef std::pair<float, int> entry;
+	std::priority_queue<entry, vector<entry>, std::greater<entry>> open;
+	cost[source] = 0;
+	searchTouched.push_back(source);
+	open.push(entry(0, source));
+
+	const float sqrt2 = 1.41421356f;
+	while (!open.empty())
+	{
+		entry top = open.top();
+		open.pop();
+		int node = top.second;
+		if (top.first > cost[node])
+			continue;
+
+		int nx = node % latticeWidth;
+		int ny = node / latticeWidth;
+		for (int oy = -1; oy <= 1; oy++)
+		{
+			for (int ox = -1; ox <= 1; ox++)
+			{
+				int mx = nx + ox;
+				int my = ny + oy;
+				if ((ox == 0 && oy == 0) || mx < x0 || my < y0 || mx >= x1 || my >= y1)
+					continue;
+
+				int next = mx + my * latticeWidth;
+				float step = (ox != 0 && oy != 0 ? sqrt2 : 1.0f) * spacing;
+				float spend = cost[node] + step * (1.0f + (penalty[node] + penalty[next]) * 0.5f);
+				if (spend < cost[next])
+				{
+					if (cost[next] == FLT_MAX)
+						searchTouched.push_back(next);
+					cost[next] = spend;
+					open.push(entry(spend, next));
+				}
+			}
+		}
+	}
+}
+
+void NavGraph::LinkPortals(int cluster)
+{
+	const vector<int>& inCluster = clusterPortals[cluster];
+	for (int i = 0; i < inCluster.size(); i++)
+	{
+		ClusterSearch(cluster, portals[inCluster[i]].node, searchCost);
+		for (int j = 0; j < inCluster.size(); j++)
+		{
+			if (i == j)
+				continue;
+			edges[inCluster[i]].push_back(Edge{ inCluster[j], searchCost[portals[inCluster[j]].node] });
+		}
+	}
+}
+
+bool NavGraph::FindCorridor(ofPoint start, ofPoint end, const vector<float>& extraPenalty, int margin, vector<bool>& corridor)
+{
+	corridor.assign(clusterPortals.size(), false);
+	if (!IsBuilt())
+		return false;
+
+	int startNode = NodeAt(start);
+	int endNode = NodeAt(end);
+	int startCluster = ClusterOf(startNode);
+	int endCluster = ClusterOf(endNode);
+
+	vector<int> route;
+	if (startCluster != endCluster)
+	{
+		// start and end join the graph as two extra nodes, linked to the portals of their cluster
+		int count = portals.size();
+		int startId = count;
+		int endId = count + 1;
+
+		vector<float> toEnd(clusterPortals[endCluster].size());
+		ClusterSearch(endCluster, endNode, searchCost);
+		for (int i = 0; i < toEnd.size(); i++)
+			toEnd[i] = searchCost[portals[clusterPortals[endCluster][i]].node];
+
+		vector<float> spend(count + 2, FLT_MAX);
+		vector<int> parent(count + 2, -1);
+		typedef std::pair<float, int> entry;
+		std::priority_queue<entry, vector<entry>, std::greater<entry>> open;
+
+		ClusterSearch(startCluster, startNode, searchCost);
+		for (int portal : clusterPortals[startCluster])
+		{
+			spend[portal] = searchCost[portals[portal].node];
+			parent[portal] = startId;
+			open.push(entry(spend[portal] + portals[portal].pos.distance(end), portal));
+		}
+
+		// every edge costs at least the distance it covers, so distance to the end never overestimates
+		while (!open.empty())
+		{
+			entry top = open.top();
+			open.pop();
+			int id = top.second;
+			if (id == endId)
+				break;
+			if (top.first > spend[id] + portals[id].pos.distance(end))
+				continue;
+
+			for (const Edge& edge : edges[id])
+			{
+				float extra = 0;
+				if (!extraPenalty.empty())
+					extra = portals[id].pos.distance(portals[edge.to].pos) * (extraPenalty[id] + extraPenalty[edge.to]) * 0.5f;
+				float cost = spend[id] + edge.cost + extra;
+				if (cost < spend[edge.to])
+				{
+					spend[edge.to] = cost;
+					parent[edge.to] = id;
+					open.push(entry(cost + portals[edge.to].pos.distance(end), edge.to));
+				}
+			}
+
+			if (portals[id].cluster == endCluster)
+			{
+				for (int i = 0; i < toEnd.size(); i++)
+				{
+					if (clusterPortals[endCluster][i] != id)
+						continue;
+					float cost = spend[id] + toEnd[i];
+					if (cost < spend[endId])
+					{
+						spend[endId] = cost;
+						parent[endId] = id;
+						open.push(entry(cost, endId));
+					}
+				}
+			}
+		}
+
+		if (parent[endId] == -1)
+			return false;
+
+		for (int id = parent[endId]; id != startId; id = parent[id])
+			route.push_back(portals[id].cluster);
+	}
+	route.push_back(startCluster);
+	route.push_back(endCluster);
+
+	for (int cluster : route)
+	{
+		int cx = cluster % clustersX;
+		int cy = cluster / clustersX;
+		for (int y = std::max(0, cy - margin); y <= std::min(clustersY - 1, cy + margin); y++)
+		{
+			for (int x = std::max(0, cx - margin); x <= std::min(clustersX - 1, cx + margin); x++)
+			{
+				corridor[x + y * clustersX] = true;
+			}
+		}
+	}
+	return true;
+}
+
+bool NavGraph::InCorridor(const vector<bool>& corridor, ofPoint pos) const
+{
+	if (corridor.empty())
+		return true;
+	return corridor[ClusterOf(NodeAt(pos))];
+}
+
+void NavGraph::DebugDraw(const vector<bool>& corridor)
+{
+	float clusterSize = clusterNodes * spacing;
+	ofSetColor(0, 200, 255, 60);
+	for (int cluster = 0; cluster < corridor.size(); cluster++)
+	{
+		if (!corridor[cluster])
+			continue;
+		ofPoint corner = ofPoint(cluster % clustersX, cluster / clustersX) * clusterSize - ofPoint(spacing / 2, spacing / 2);
+		ofDrawRectangle(corner, clusterSize, clusterSize);
+	}
+
+	ofSetColor(0, 100, 255, 255);
+	for (auto& portal : portals)
+	{
+		ofDrawCircle(portal.pos, 2);
+	}
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include "ofMain.h"
+
+#include <vector>
+
+// Coarse navigation layer over the route lattice, built once per map (HPA* style).
+// The lattice is cut into square clusters, neighbouring clusters are joined by portals at the
+// cheapest crossings along their shared border, and portals inside a cluster are linked by
+// their cheapest in-cluster cost. A route searches this small graph first, and the lattice
+// search is then kept to the clusters it passed through.
+class NavGraph
+{
+public:
+	NavGraph();
+	~NavGraph();
+
+	// penalty holds one value per lattice node (x + y * latticeWidth); a step costs its
+	// length times 1 + the average penalty of its two ends.
+	void Build(int latticeWidth, int latticeHeight, float spacing, int clusterNodes, const vector<float>& penalty);
+	void Clear();
+	bool IsBuilt() const { return !clusterPortals.empty(); }
+
+	int GetPortalCount() const { return portals.size(); }
+	ofPoint GetPortalPos(int portal) const { return portals[portal].pos; }
+
+	// extraPenalty is optional, one per portal, for route specific costs on top of the shared ones.
+	// Marks the clusters the coarse route goes through, plus margin clusters around them.
+	bool FindCorridor(ofPoint start, ofPoint end, const vector<float>& extraPenalty, int margin, vector<bool>& corridor);
+	bool InCorridor(const vector<bool>& corridor, ofPoint pos) const;
+
+	void DebugDraw(const vector<bool>& corridor);
+
+private:
+	struct Portal {
+		int node;
+		int cluster;
+		ofPoint pos;
+	};
+	struct Edge {
+		int to;
+		float cost;
+	};
+
+	int NodeAt(ofPoint pos) const;
+	int ClusterOf(int node) const;
+	ofPoint NodePos(int node) const;
+	int AddPortal(int node, int cluster);
+	void LinkPortals(int cluster);
+	// Dijkstra from source over the nodes of one cluster; fills cost for the whole lattice
+	void ClusterSearch(int cluster, int source, vector<float>& cost);
+
+	int latticeWidth;
+	int latticeHeight;
+	float spacing;
+	int clusterNodes;
+	int clustersX;
+	int clustersY;
+	vector<float> penalty;
+
+	vector<Portal> portals;
+	vector<vector<Edge>> edges;
+	vector<vector<int>> clusterPortals;
+
+	// scratch for ClusterSearch
+	vector<float> searchCost;
+	vector<int> searchTouched;
+};
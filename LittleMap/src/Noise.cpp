@@ -1,27 +1,407 @@
 #include "Noise.h"
 
-float roffsetx = 0;
-float roffsety = 0;
+#include <mutex>
 
-float Noise(float x, float y, int octaves, float alpha, float beta)
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define NOISE_SIMD 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define NOISE_AVX2
+#else
+#define NOISE_AVX2 __attribute__((target("avx2")))
+#endif
+#else
+#define NOISE_SIMD 0
+#endif
+
+// This is a 2D simplex noise with the same math as ofNoise (Gustavson's, by way of Mesa),
+// so that NoiseCompatible gives back the exact same terrain as before. The SIMD kernels do the
+// same float operations in the same order as the scalar one, so they all agree bit for bit.
+
+// Ken Perlin's reference permutation, which is what ofNoise uses.
+static const unsigned char classicPerm[256] = {
+	151, 160, 137, 91, 90, 15, 131, 13, 201, 95, 96, 53, 194, 233, 7, 225,
+	140, 36, 103, 30, 69, 142, 8, 99, 37, 240, 21, 10, 23, 190, 6, 148,
+	247, 120, 234, 75, 0, 26, 197, 62, 94, 252, 219, 203, 117, 35, 11, 32,
+	57, 177, 33, 88, 237, 149, 56, 87, 174, 20, 125, 136, 171, 168, 68, 175,
+	74, 165, 71, 134, 139, 48, 27, 166, 77, 146, 158, 231, 83, 111, 229, 122,
+	60, 211, 133, 230, 220, 105, 92, 41, 55, 46, 245, 40, 244, 102, 143, 54,
+	65, 25, 63, 161, 1, 216, 80, 73, 209, 76, 132, 187, 208, 89, 18, 169,
+	200, 196, 135, 130, 116, 188, 159, 86, 164, 100, 109, 198, 173, 186, 3, 64,
+	52, 217, 226, 250, 124, 123, 5, 202, 38, 147, 118, 126, 255, 82, 85, 212,
+	207, 206, 59, 227, 47, 16, 58, 17, 182, 189, 28, 42, 223, 183, 170, 213,
+	119, 248, 152, 2, 44, 154, 163, 70, 221, 153, 101, 155, 167, 43, 172, 9,
+	129, 22, 39, 253, 19, 98, 108, 110, 79, 113, 224, 232, 178, 185, 112, 104,
+	218, 246, 97, 228, 251, 34, 242, 193, 238, 210, 144, 12, 191, 179, 162, 241,
+	81, 51, 145, 235, 249, 14, 239, 107, 49, 192, 214, 31, 181, 199, 106, 157,
+	184, 84, 204, 176, 115, 121, 50, 45, 127, 4, 150, 254, 138, 236, 205, 93,
+	222, 114, 67, 29, 24, 72, 243, 141, 128, 195, 78, 66, 215, 61, 156, 180,
+};
+
+// ofSeedRandom/ofRandom are one global stream, only NoiseCompatible seeding touches them
+static std::mutex ofRandomLock;
+
+static const float F2 = 0.366025403f; // 0.5*(sqrt(3.0)-1.0)
+static const float G2 = 0.211324865f; // (3.0-sqrt(3.0))/6.0
+
+NoiseOctaves::NoiseOctaves(int octaves, float alpha, float beta)
+{
+	this->octaves = std::min(octaves, maxNoiseOctaves);
+	total = 0;
+	for (int n = 0; n < this->octaves; n++)
+	{
+		weight[n] = 1.0f / std::pow(alpha, n);
+		total += weight[n];
+		frequency[n] = std::pow(beta, n);
+	}
+}
+
+// Not quite floor(): 0 goes to -1. Kept because ofNoise does it too.
+static inline int FastFloor(float v)
+{
+	return v > 0 ? (int)v : ((int)v) - 1;
+}
+
+static inline float Grad(int hash, float x, float y)
+{
+	int h = hash & 7;
+	float u = h < 4 ? x : y;
+	float v = h < 4 ? y : x;
+	return ((h & 1) ? -u : u) + ((h & 2) ? -2.0f*v : 2.0f*v);
+}
+
+static float Simplex(const int* perm, float x, float y)
+{
+	float s = (x + y) * F2;
+	int i = FastFloor(x + s);
+	int j = FastFloor(y + s);
+	float t = (float)(i + j) * G2;
+	float x0 = x - (i - t);
+	float y0 = y - (j - t);
+
+	int i1 = x0 > y0 ? 1 : 0;
+	int j1 = 1 - i1;
+
+	float x1 = x0 - i1 + G2;
+	float y1 = y0 - j1 + G2;
+	float x2 = x0 - 1.0f + 2.0f * G2;
+	float y2 = y0 - 1.0f + 2.0f * G2;
+
+	int ii = i & 0xff;
+	int jj = j & 0xff;
+
+	float n0 = 0, n1 = 0, n2 = 0;
+	float t0 = 0.5f - x0*x0 - y0*y0;
+	if (t0 >= 0.0f)
+	{
+		t0 *= t0;
+		n0 = t0 * t0 * Grad(perm[ii + perm[jj]], x0, y0);
+	}
+	float t1 = 0.5f - x1*x1 - y1*y1;
+	if (t1 >= 0.0f)
+	{
+		t1 *= t1;
+		n1 = t1 * t1 * Grad(perm[ii + i1 + perm[jj + j1]], x1, y1);
+	}
+	float t2 = 0.5f - x2*x2 - y2*y2;
+	if (t2 >= 0.0f)
+	{
+		t2 *= t2;
+		n2 = t2 * t2 * Grad(perm[ii + 1 + perm[jj + 1]], x2, y2);
+	}
+
+	return 40.0f * (n0 + n1 + n2);
+}
+
+static float Fbm(const NoiseSeed& noise, float x, float y, const NoiseOctaves& o)
 {
 	float t = 0;
-	float max = 0;
+	for (int n = 0; n < o.octaves; n++)
+	{
+		float v = Simplex(noise.perm, o.frequency[n] * x + noise.offsetx, o.frequency[n] * y + noise.offsety);
+		t += o.weight[n] * (v * 0.5f + 0.5f);
+	}
+	return t / o.total;
+}
 
-	for (int n = 0; n < octaves; n++)
+static void NoiseRowScalar(const NoiseSeed& noise, float* out, int count, float startX, float stepX, float y, float scale, const NoiseOctaves& o)
+{
+	float ys = y * scale;
+	for (int i = 0; i < count; i++)
 	{
-		float factor = 1.0f / std::pow(alpha, n);
-		max += factor;
-		float betapow = std::pow(beta, n);
-		t += factor * ofNoise(betapow * x + roffsetx, betapow * y + roffsety);
+		out[i] = Fbm(noise, (startX + i * stepX) * scale, ys, o);
 	}
+}
 
-	return t/max;
+#if NOISE_SIMD
+
+static inline __m128 Select4(__m128 mask, __m128 a, __m128 b)
+{
+	return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
 }
 
-void SetNoiseSeed(int seed)
+static inline __m128i FastFloor4(__m128 v)
 {
-	ofSeedRandom(seed);
-	roffsetx = ofRandom(1024.0f); // some arbitrary number, lets just move around the space a bit
-	roffsety = ofRandom(1024.0f); // some arbitrary number, lets just move around the space a bit
+	// truncate, then take one off anything <= 0; the mask is all ones, i.e. -1
+	__m128i t = _mm_cvttps_epi32(v);
+	return _mm_add_epi32(t, _mm_castps_si128(_mm_cmple_ps(v, _mm_setzero_ps())));
+}
+
+static inline __m128 Grad4(__m128i hash, __m128 x, __m128 y)
+{
+	__m128i h = _mm_and_si128(hash, _mm_set1_epi32(7));
+	__m128 low = _mm_castsi128_ps(_mm_cmplt_epi32(h, _mm_set1_epi32(4)));
+	__m128 u = Select4(low, x, y);
+	__m128 v = _mm_mul_ps(_mm_set1_ps(2.0f), Select4(low, y, x));
+	__m128 signU = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(h, _mm_set1_epi32(1)), 31));
+	__m128 signV = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(h, _mm_set1_epi32(2)), 30));
+	return _mm_add_ps(_mm_xor_ps(u, signU), _mm_xor_ps(v, signV));
+}
+
+static inline __m128 Corner4(__m128 x, __m128 y, __m128i hash)
+{
+	__m128 t = _mm_sub_ps(_mm_sub_ps(_mm_set1_ps(0.5f), _mm_mul_ps(x, x)), _mm_mul_ps(y, y));
+	__m128 inside = _mm_cmpge_ps(t, _mm_setzero_ps());
+	t = _mm_mul_ps(t, t);
+	__m128 n = _mm_mul_ps(_mm_mul_ps(t, t), Grad4(hash, x, y));
+	return _mm_and_ps(inside, n);
+}
+
+static inline __m128 Simplex4(const int* perm, __m128 x, __m128 y)
+{
+	__m128 s = _mm_mul_ps(_mm_add_ps(x, y), _mm_set1_ps(F2));
+	__m128i i = FastFloor4(_mm_add_ps(x, s));
+	__m128i j = FastFloor4(_mm_add_ps(y, s));
+	__m128 g2 = _mm_set1_ps(G2);
+	__m128 t = _mm_mul_ps(_mm_cvtepi32_ps(_mm_add_epi32(i, j)), g2);
+	__m128 x0 = _mm_sub_ps(x, _mm_sub_ps(_mm_cvtepi32_ps(i), t));
+	__m128 y0 = _mm_sub_ps(y, _mm_sub_ps(_mm_cvtepi32_ps(j), t));
+
+	__m128i i1 = _mm_srli_epi32(_mm_castps_si128(_mm_cmpgt_ps(x0, y0)), 31);
+	__m128i j1 = _mm_sub_epi32(_mm_set1_epi32(1), i1);
+
+	__m128 x1 = _mm_add_ps(_mm_sub_ps(x0, _mm_cvtepi32_ps(i1)), g2);
+	__m128 y1 = _mm_add_ps(_mm_sub_ps(y0, _mm_cvtepi32_ps(j1)), g2);
+	__m128 x2 = _mm_add_ps(_mm_sub_ps(x0, _mm_set1_ps(1.0f)), _mm_set1_ps(2.0f * G2));
+	__m128 y2 = _mm_add_ps(_mm_sub_ps(y0, _mm_set1_ps(1.0f)), _mm_set1_ps(2.0f * G2));
+
+	// no gathers before AVX2, so look the hashes up a lane at a time
+	__m128i mask = _mm_set1_epi32(0xff);
+	alignas(16) int ii[4], jj[4], i1s[4], h0[4], h1[4], h2[4];
+	_mm_store_si128((__m128i*)ii, _mm_and_si128(i, mask));
+	_mm_store_si128((__m128i*)jj, _mm_and_si128(j, mask));
+	_mm_store_si128((__m128i*)i1s, i1);
+	for (int k = 0; k < 4; k++)
+	{
+		h0[k] = perm[ii[k] + perm[jj[k]]];
+		h1[k] = perm[ii[k] + i1s[k] + perm[jj[k] + 1 - i1s[k]]];
+		h2[k] = perm[ii[k] + 1 + perm[jj[k] + 1]];
+	}
+
+	__m128 n0 = Corner4(x0, y0, _mm_load_si128((__m128i*)h0));
+	__m128 n1 = Corner4(x1, y1, _mm_load_si128((__m128i*)h1));
+	__m128 n2 = Corner4(x2, y2, _mm_load_si128((__m128i*)h2));
+	return _mm_mul_ps(_mm_set1_ps(40.0f), _mm_add_ps(_mm_add_ps(n0, n1), n2));
+}
+
+static void NoiseRowSSE(const NoiseSeed& noise, float* out, int count, float startX, float stepX, float y, float scale, const NoiseOctaves& o)
+{
+	float ys = y * scale;
+	__m128 half = _mm_set1_ps(0.5f);
+	__m128 total = _mm_set1_ps(o.total);
+	int i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 idx = _mm_cvtepi32_ps(_mm_add_epi32(_mm_set1_epi32(i), _mm_setr_epi32(0, 1, 2, 3)));
+		__m128 xs = _mm_mul_ps(_mm_add_ps(_mm_set1_ps(startX), _mm_mul_ps(idx, _mm_set1_ps(stepX))), _mm_set1_ps(scale));
+
+		__m128 t = _mm_setzero_ps();
+		for (int n = 0; n < o.octaves; n++)
+		{
+			__m128 px = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(o.frequency[n]), xs), _mm_set1_ps(noise.offsetx));
+			__m128 py = _mm_set1_ps(o.frequency[n] * ys + noise.offsety);
+			__m128 v = Simplex4(noise.perm, px, py);
+			t = _mm_add_ps(t, _mm_mul_ps(_mm_set1_ps(o.weight[n]), _mm_add_ps(_mm_mul_ps(v, half), half)));
+		}
+		_mm_storeu_ps(out + i, _mm_div_ps(t, total));
+	}
+	NoiseRowScalar(noise, out + i, count - i, startX + i * stepX, stepX, y, scale, o);
+}
+
+static NOISE_AVX2 inline __m256 Select8(__m256 mask, __m256 a, __m256 b)
+{
+	return _mm256_or_ps(_mm256_and_ps(mask, a), _mm256_andnot_ps(mask, b));
+}
+
+static NOISE_AVX2 inline __m256i FastFloor8(__m256 v)
+{
+	__m256i t = _mm256_cvttps_epi32(v);
+	return _mm256_add_epi32(t, _mm256_castps_si256(_mm256_cmp_ps(v, _mm256_setzero_ps(), _CMP_LE_OQ)));
+}
+
+static NOISE_AVX2 inline __m256 Grad8(__m256i hash, __m256 x, __m256 y)
+{
+	__m256i h = _mm256_and_si256(hash, _mm256_set1_epi32(7));
+	__m256 low = _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(4), h));
+	__m256 u = Select8(low, x, y);
+	__m256 v = _mm256_mul_ps(_mm256_set1_ps(2.0f), Select8(low, y, x));
+	__m256 signU = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(h, _mm256_set1_epi32(1)), 31));
+	__m256 signV = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(h, _mm256_set1_epi32(2)), 30));
+	return _mm256_add_ps(_mm256_xor_ps(u, signU), _mm256_xor_ps(v, signV));
+}
+
+static NOISE_AVX2 inline __m256 Corner8(__m256 x, __m256 y, __m256i hash)
+{
+	__m256 t = _mm256_sub_ps(_mm256_sub_ps(_mm256_set1_ps(0.5f), _mm256_mul_ps(x, x)), _mm256_mul_ps(y, y));
+	__m256 inside = _mm256_cmp_ps(t, _mm256_setzero_ps(), _CMP_GE_OQ);
+	t = _mm256_mul_ps(t, t);
+	__m256 n = _mm256_mul_ps(_mm256_mul_ps(t, t), Grad8(hash, x, y));
+	return _mm256_and_ps(inside, n);
+}
+
+static NOISE_AVX2 inline __m256 Simplex8(const int* perm, __m256 x, __m256 y)
+{
+	__m256 s = _mm256_mul_ps(_mm256_add_ps(x, y), _mm256_set1_ps(F2));
+	__m256i i = FastFloor8(_mm256_add_ps(x, s));
+	__m256i j = FastFloor8(_mm256_add_ps(y, s));
+	__m256 g2 = _mm256_set1_ps(G2);
+	__m256 t = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_add_epi32(i, j)), g2);
+	__m256 x0 = _mm256_sub_ps(x, _mm256_sub_ps(_mm256_cvtepi32_ps(i), t));
+	__m256 y0 = _mm256_sub_ps(y, _mm256_sub_ps(_mm256_cvtepi32_ps(j), t));
+
+	__m256i i1 = _mm256_srli_epi32(_mm256_castps_si256(_mm256_cmp_ps(x0, y0, _CMP_GT_OQ)), 31);
+	__m256i one = _mm256_set1_epi32(1);
+	__m256i j1 = _mm256_sub_epi32(one, i1);
+
+	__m256 x1 = _mm256_add_ps(_mm256_sub_ps(x0, _mm256_cvtepi32_ps(i1)), g2);
+	__m256 y1 = _mm256_add_ps(_mm256_sub_ps(y0, _mm256_cvtepi32_ps(j1)), g2);
+	__m256 x2 = _mm256_add_ps(_mm256_sub_ps(x0, _mm256_set1_ps(1.0f)), _mm256_set1_ps(2.0f * G2));
+	__m256 y2 = _mm256_add_ps(_mm256_sub_ps(y0, _mm256_set1_ps(1.0f)), _mm256_set1_ps(2.0f * G2));
+
+	__m256i mask = _mm256_set1_epi32(0xff);
+	__m256i ii = _mm256_and_si256(i, mask);
+	__m256i jj = _mm256_and_si256(j, mask);
+	__m256i h0 = _mm256_i32gather_epi32(perm, _mm256_add_epi32(ii, _mm256_i32gather_epi32(perm, jj, 4)), 4);
+	__m256i h1 = _mm256_i32gather_epi32(perm, _mm256_add_epi32(_mm256_add_epi32(ii, i1),
+		_mm256_i32gather_epi32(perm, _mm256_add_epi32(jj, j1), 4)), 4);
+	__m256i h2 = _mm256_i32gather_epi32(perm, _mm256_add_epi32(_mm256_add_epi32(ii, one),
+		_mm256_i32gather_epi32(perm, _mm256_add_epi32(jj, one), 4)), 4);
+
+	__m256 n0 = Corner8(x0, y0, h0);
+	__m256 n1 = Corner8(x1, y1, h1);
+	__m256 n2 = Corner8(x2, y2, h2);
+	return _mm256_mul_ps(_mm256_set1_ps(40.0f), _mm256_add_ps(_mm256_add_ps(n0, n1), n2));
+}
+
+static NOISE_AVX2 void NoiseRowAVX2(const NoiseSeed& noise, float* out, int count, float startX, float stepX, float y, float scale, const NoiseOctaves& o)
+{
+	float ys = y * scale;
+	__m256 half = _mm256_set1_ps(0.5f);
+	__m256 total = _mm256_set1_ps(o.total);
+	int i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		__m256 idx = _mm256_cvtepi32_ps(_mm256_add_epi32(_mm256_set1_epi32(i), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7)));
+		__m256 xs = _mm256_mul_ps(_mm256_add_ps(_mm256_set1_ps(startX), _mm256_mul_ps(idx, _mm256_set1_ps(stepX))), _mm256_set1_ps(scale));
+
+		__m256 t = _mm256_setzero_ps();
+		for (int n = 0; n < o.octaves; n++)
+		{
+			__m256 px = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(o.frequency[n]), xs), _mm256_set1_ps(noise.offsetx));
+			__m256 py = _mm256_set1_ps(o.frequency[n] * ys + noise.offsety);
+			__m256 v = Simplex8(noise.perm, px, py);
+			t = _mm256_add_ps(t, _mm256_mul_ps(_mm256_set1_ps(o.weight[n]), _mm256_add_ps(_mm256_mul_ps(v, half), half)));
+		}
+		_mm256_storeu_ps(out + i, _mm256_div_ps(t, total));
+	}
+	NoiseRowSSE(noise, out + i, count - i, startX + i * stepX, stepX, y, scale, o);
+}
+
+bool CpuHasAVX2()
+{
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7)
+		return false;
+	__cpuid(info, 1);
+	bool osxsave = (info[2] & (1 << 27)) != 0;
+	bool avx = (info[2] & (1 << 28)) != 0;
+	if (!osxsave || !avx || (_xgetbv(0) & 6) != 6)
+		return false;
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#else
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2") != 0;
+#endif
+}
+
+#else
+
+bool CpuHasAVX2()
+{
+	return false;
+}
+
+#endif
+
+typedef void (*NoiseRowKernel)(const NoiseSeed& noise, float* out, int count, float startX, float stepX, float y, float scale, const NoiseOctaves& o);
+
+static NoiseRowKernel PickRowKernel()
+{
+#if NOISE_SIMD
+	if (CpuHasAVX2())
+		return NoiseRowAVX2;
+	return NoiseRowSSE;
+#else
+	return NoiseRowScalar;
+#endif
+}
+
+float Noise(const NoiseSeed& noise, float x, float y, const NoiseOctaves& octaves)
+{
+	return Fbm(noise, x, y, octaves);
+}
+
+void NoiseRow(const NoiseSeed& noise, float* out, int count, float startX, float stepX, float y, float scale, const NoiseOctaves& octaves)
+{
+	static NoiseRowKernel kernel = PickRowKernel();
+	kernel(noise, out, count, startX, stepX, y, scale, octaves);
+}
+
+void SeedNoise(NoiseSeed& noise, int seed, NoiseMode mode)
+{
+	for (int i = 0; i < 256; i++)
+	{
+		noise.perm[i] = classicPerm[i];
+	}
+
+	if (mode == NoiseCompatible)
+	{
+		std::lock_guard<std::mutex> lock(ofRandomLock);
+		ofSeedRandom(seed);
+		noise.offsetx = ofRandom(1024.0f); // some arbitrary number, lets just move around the space a bit
+		noise.offsety = ofRandom(1024.0f); // some arbitrary number, lets just move around the space a bit
+	}
+	else
+	{
+		noise.offsetx = 0;
+		noise.offsety = 0;
+
+		unsigned int state = (unsigned int)seed * 2654435761u + 1;
+		for (int i = 255; i > 0; i--)
+		{
+			state ^= state << 13;
+			state ^= state >> 17;
+			state ^= state << 5;
+			std::swap(noise.perm[i], noise.perm[state % (i + 1)]);
+		}
+	}
+
+	for (int i = 0; i < 256; i++)
+	{
+		noise.perm[i + 256] = noise.perm[i];
+	}
 }
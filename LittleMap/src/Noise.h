@@ -1,5 +1,44 @@
 #pragma once
 #include "ofMain.h"
 
-float Noise(float x, float y, int octaves, float alpha, float beta);
-void SetNoiseSeed(int seed);
+const int maxNoiseOctaves = 8;
+
+// Per-octave weights and frequencies for one (octaves, alpha, beta) setting.
+// Build one of these up front instead of paying for the pow() calls on every sample.
+struct NoiseOctaves
+{
+	NoiseOctaves(int octaves, float alpha, float beta);
+
+	int octaves;
+	float weight[maxNoiseOctaves];
+	float frequency[maxNoiseOctaves];
+	float total;
+};
+
+enum NoiseMode {
+	// ofNoise's fixed permutation shifted by a seeded offset; matches the old noise exactly. Only
+	// the noise: the stages draw from the Generator's own streams rather than ofRandom now, so
+	// landmarks, paths and the legend still differ from the old maps.
+	NoiseCompatible,
+	// permutation shuffled from the seed, no offset
+	NoiseSeeded,
+};
+
+// Permutation and offset for one seeded noise field. Each map keeps its own,
+// so nothing here is shared between threads.
+struct NoiseSeed
+{
+	int perm[512];
+	float offsetx;
+	float offsety;
+};
+
+void SeedNoise(NoiseSeed& noise, int seed, NoiseMode mode);
+
+float Noise(const NoiseSeed& noise, float x, float y, const NoiseOctaves& octaves);
+
+// out[i] = Noise((startX + i*stepX) * scale, y * scale, octaves), using the widest kernel the CPU has.
+void NoiseRow(const NoiseSeed& noise, float* out, int count, float startX, float stepX, float y, float scale, const NoiseOctaves& octaves);
+
+// True when both the CPU and the OS support AVX2. Always false off x86.
+bool CpuHasAVX2();
@@ -1,17 +1,19 @@
 #include "Paper.h"
 
-#include "Noise.h"
 #include "RoughDrawer.h"
 
 int margin = 25;
 const float gridNoiseScale = 0.05f;
 const float gridWobble = 8.0f;
 const float gridDetail = 12.0f;
+const NoiseOctaves paperOctaves(3, 0.5f, 0.4f);
 
 
-Paper::Paper(Legend& legendRef)
-	: legendRef(legendRef)
+Paper::Paper(Generator& generator, Legend& legendRef)
+	: generator(generator)
+	, legendRef(legendRef)
 {
+	DependsOn(&legendRef);
 }
 
 Paper::~Paper()
@@ -35,11 +37,13 @@ void Paper::Reset()
 
 float Paper::PaperNoise(float x, float y)
 {
-	return Noise(x*gridNoiseScale, y*gridNoiseScale, 3, 0.5f, 0.4f);
+	return generator.Noise(x*gridNoiseScale, y*gridNoiseScale, paperOctaves);
 }
 
 bool Paper::Render()
 {
+	rng = generator.GetStream(Generator::StreamPaper);
+
 	ofRectangle legendBounds = legendRef.GetBounds();
 	legendBounds.translate(-margin, -margin);
 	legendBounds.setWidth(legendBounds.getWidth() + margin * 2);
@@ -85,15 +89,13 @@ bool Paper::Render()
 	ofFill();
 	ofEnableSmoothing();
 
-	ofTessellator tesselator = ofTessellator();
-	ofMesh mesh;
-	tesselator.tessellateToMesh(path, ofPolyWindingMode::OF_POLY_WINDING_ODD, mesh);
-	mesh.draw();
+	tessellator.tessellateToMesh(path, ofPolyWindingMode::OF_POLY_WINDING_ODD, paperMesh);
+	paperMesh.draw();
 
 	ofSetColor(ofColor::black);
 	ofFill();
 	ofEnableSmoothing();
-	RoughTracePath(path, 1.5f, 3.0f);
+	RoughTracePath(path, 1.5f, 3.0f, rng);
 
 	image.end();
 	return true;
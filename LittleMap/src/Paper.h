@@ -2,12 +2,14 @@
 #include "Stage.h"
 #include "ofMain.h"
 
+#include "Generator.h"
+
 #include "Legend.h"
 
 class Paper : public Stage
 {
 public:
-	Paper(Legend& legendRef);
+	Paper(Generator& generator, Legend& legendRef);
 	~Paper();
 
 	virtual void Setup();
@@ -16,10 +18,15 @@ public:
 	virtual void Reset();
 
 private:
+	Generator& generator;
+	Random rng;
 	Legend& legendRef;
 	
 	float PaperNoise(float x, float y);
 
+	ofTessellator tessellator;
+	ofMesh paperMesh;
+
 	ofFbo image;
 };
 
@@ -0,0 +1,303 @@
+#include "PathCost.h"
+#include "Noise.h"
+
+#include <chrono>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define PATHCOST_SIMD 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#define PATHCOST_AVX2
+#else
+#define PATHCOST_AVX2 __attribute__((target("avx2")))
+#endif
+#else
+#define PATHCOST_SIMD 0
+#endif
+
+// As in Noise.cpp, the SIMD kernels do the same float operations in the same order as the
+// scalar one, so a route comes out the same whichever kernel found it.
+
+int benchmarkRepeats = 20;
+
+StepCostRoute::StepCostRoute(ofPoint start, ofPoint target, float startVal, float targetVal, float segDist, float shoreScale)
+	: targetX(target.x)
+	, targetY(target.y)
+	, startVal(startVal)
+	, targetVal(targetVal)
+	, pathDist(target.distance(start))
+	, lowPoint(std::min(startVal, targetVal))
+	, highPoint(std::max(startVal, targetVal))
+	, segDist(segDist)
+	, shoreScale(shoreScale)
+{
+}
+
+float StepCost(const StepCostRoute& route, float x, float y, float nextVal, float nextShore)
+{
+	float dx = route.targetX - x;
+	float dy = route.targetY - y;
+	float nextDist = std::sqrt(dx * dx + dy * dy);
+	float idealHeight = std::min(route.highPoint, std::max(route.lowPoint,
+		(route.startVal - route.targetVal) * (nextDist / route.pathDist) + route.targetVal));
+
+	float valCost = std::abs(nextVal - idealHeight) * route.segDist * 4000.0f;
+
+	float distCost = nextDist;
+	if (nextDist > route.pathDist)
+	{
+		float outerPart = nextDist - route.pathDist;
+		distCost += outerPart * outerPart;
+	}
+
+	float shoreCost = std::min(std::abs(route.shoreScale / nextShore), 10000.0f);
+	return distCost + valCost + shoreCost;
+}
+
+static int RemoveSeen(const StepCostField& field, const int* key, int open)
+{
+	if (field.seen == nullptr)
+		return open;
+	for (int i = 0; i < 8; i++)
+	{
+		if ((open & (1 << i)) && field.seen[key[i]])
+			open &= ~(1 << i);
+	}
+	return open;
+}
+
+static void ExpandScalar(const StepCostField& field, const StepCostRoute& route, const float* stepX, const float* stepY, float x, float y, NeighbourBatch& out)
+{
+	int open = 0;
+	for (int i = 0; i < 8; i++)
+	{
+		float nx = x + stepX[i];
+		float ny = y + stepY[i];
+		// same lookup as CurveTerrain::GetLandValue
+		int ix = (int)std::floor(std::min((float)(field.width - 1), std::max(0.0f, nx)));
+		int iy = (int)std::floor(std::min((float)(field.height - 1), std::max(0.0f, ny)));
+
+		out.x[i] = nx;
+		out.y[i] = ny;
+		int idx = ix + iy * field.width;
+		out.cost[i] = StepCost(route, nx, ny, field.land[idx], field.shore[idx]);
+		out.key[i] = (int)nx + (int)(ny * field.width);
+		if (nx >= 0 && ny >= 0 && nx <= field.width && ny <= field.height)
+			open |= 1 << i;
+	}
+	out.open = RemoveSeen(field, out.key, open);
+}
+
+#if PATHCOST_SIMD
+
+static inline __m128 StepCost4(const StepCostRoute& route, __m128 x, __m128 y, __m128 nextVal, __m128 nextShore)
+{
+	__m128 sign = _mm_set1_ps(-0.0f);
+	__m128 pathDist = _mm_set1_ps(route.pathDist);
+	__m128 dx = _mm_sub_ps(_mm_set1_ps(route.targetX), x);
+	__m128 dy = _mm_sub_ps(_mm_set1_ps(route.targetY), y);
+	__m128 nextDist = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)));
+	__m128 lerped = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(route.startVal - route.targetVal), _mm_div_ps(nextDist, pathDist)), _mm_set1_ps(route.targetVal));
+	__m128 idealHeight = _mm_min_ps(_mm_set1_ps(route.highPoint), _mm_max_ps(_mm_set1_ps(route.lowPoint), lerped));
+
+	__m128 valDiff = _mm_andnot_ps(sign, _mm_sub_ps(nextVal, idealHeight));
+	__m128 valCost = _mm_mul_ps(_mm_mul_ps(valDiff, _mm_set1_ps(route.segDist)), _mm_set1_ps(4000.0f));
+
+	__m128 outerPart = _mm_sub_ps(nextDist, pathDist);
+	__m128 outside = _mm_cmpgt_ps(nextDist, pathDist);
+	__m128 distCost = _mm_add_ps(nextDist, _mm_and_ps(outside, _mm_mul_ps(outerPart, outerPart)));
+
+	__m128 shoreCost = _mm_min_ps(_mm_andnot_ps(sign, _mm_div_ps(_mm_set1_ps(route.shoreScale), nextShore)), _mm_set1_ps(10000.0f));
+
+	return _mm_add_ps(_mm_add_ps(distCost, valCost), shoreCost);
+}
+
+static void ExpandSSE(const StepCostField& field, const StepCostRoute& route, const float* stepX, const float* stepY, float x, float y, NeighbourBatch& out)
+{
+	__m128 zero = _mm_setzero_ps();
+	__m128 maxX = _mm_set1_ps((float)(field.width - 1));
+	__m128 maxY = _mm_set1_ps((float)(field.height - 1));
+	__m128 width = _mm_set1_ps((float)field.width);
+	__m128 height = _mm_set1_ps((float)field.height);
+
+	int open = 0;
+	for (int half = 0; half < 8; half += 4)
+	{
+		__m128 nx = _mm_add_ps(_mm_set1_ps(x), _mm_loadu_ps(stepX + half));
+		__m128 ny = _mm_add_ps(_mm_set1_ps(y), _mm_loadu_ps(stepY + half));
+
+		// no gathers before AVX2, so look the land and shore up a lane at a time
+		alignas(16) int ix[4], iy[4];
+		alignas(16) float nextVal[4], nextShore[4];
+		_mm_store_si128((__m128i*)ix, _mm_cvttps_epi32(_mm_min_ps(maxX, _mm_max_ps(zero, nx))));
+		_mm_store_si128((__m128i*)iy, _mm_cvttps_epi32(_mm_min_ps(maxY, _mm_max_ps(zero, ny))));
+		for (int k = 0; k < 4; k++)
+		{
+			int idx = ix[k] + iy[k] * field.width;
+			nextVal[k] = field.land[idx];
+			nextShore[k] = field.shore[idx];
+		}
+
+		_mm_store_ps(out.x + half, nx);
+		_mm_store_ps(out.y + half, ny);
+		_mm_store_ps(out.cost + half, StepCost4(route, nx, ny, _mm_load_ps(nextVal), _mm_load_ps(nextShore)));
+		_mm_store_si128((__m128i*)(out.key + half), _mm_add_epi32(_mm_cvttps_epi32(nx), _mm_cvttps_epi32(_mm_mul_ps(ny, width))));
+
+		__m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(nx, zero), _mm_cmpge_ps(ny, zero)),
+			_mm_and_ps(_mm_cmple_ps(nx, width), _mm_cmple_ps(ny, height)));
+		open |= _mm_movemask_ps(inside) << half;
+	}
+	out.open = RemoveSeen(field, out.key, open);
+}
+
+static PATHCOST_AVX2 inline __m256 StepCost8(const StepCostRoute& route, __m256 x, __m256 y, __m256 nextVal, __m256 nextShore)
+{
+	__m256 sign = _mm256_set1_ps(-0.0f);
+	__m256 pathDist = _mm256_set1_ps(route.pathDist);
+	__m256 dx = _mm256_sub_ps(_mm256_set1_ps(route.targetX), x);
+	__m256 dy = _mm256_sub_ps(_mm256_set1_ps(route.targetY), y);
+	__m256 nextDist = _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)));
+	__m256 lerped = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(route.startVal - route.targetVal), _mm256_div_ps(nextDist, pathDist)), _mm256_set1_ps(route.targetVal));
+	__m256 idealHeight = _mm256_min_ps(_mm256_set1_ps(route.highPoint), _mm256_max_ps(_mm256_set1_ps(route.lowPoint), lerped));
+
+	__m256 valDiff = _mm256_andnot_ps(sign, _mm256_sub_ps(nextVal, idealHeight));
+	__m256 valCost = _mm256_mul_ps(_mm256_mul_ps(valDiff, _mm256_set1_ps(route.segDist)), _mm256_set1_ps(4000.0f));
+
+	__m256 outerPart = _mm256_sub_ps(nextDist, pathDist);
+	__m256 outside = _mm256_cmp_ps(nextDist, pathDist, _CMP_GT_OQ);
+	__m256 distCost = _mm256_add_ps(nextDist, _mm256_and_ps(outside, _mm256_mul_ps(outerPart, outerPart)));
+
+	__m256 shoreCost = _mm256_min_ps(_mm256_andnot_ps(sign, _mm256_div_ps(_mm256_set1_ps(route.shoreScale), nextShore)), _mm256_set1_ps(10000.0f));
+
+	return _mm256_add_ps(_mm256_add_ps(distCost, valCost), shoreCost);
+}
+
+static PATHCOST_AVX2 void ExpandAVX2(const StepCostField& field, const StepCostRoute& route, const float* stepX, const float* stepY, float x, float y, NeighbourBatch& out)
+{
+	__m256 zero = _mm256_setzero_ps();
+	__m256 width = _mm256_set1_ps((float)field.width);
+	__m256 height = _mm256_set1_ps((float)field.height);
+	__m256 nx = _mm256_add_ps(_mm256_set1_ps(x), _mm256_loadu_ps(stepX));
+	__m256 ny = _mm256_add_ps(_mm256_set1_ps(y), _mm256_loadu_ps(stepY));
+
+	__m256i ix = _mm256_cvttps_epi32(_mm256_min_ps(_mm256_set1_ps((float)(field.width - 1)), _mm256_max_ps(zero, nx)));
+	__m256i iy = _mm256_cvttps_epi32(_mm256_min_ps(_mm256_set1_ps((float)(field.height - 1)), _mm256_max_ps(zero, ny)));
+	__m256i landIdx = _mm256_add_epi32(ix, _mm256_mullo_epi32(iy, _mm256_set1_epi32(field.width)));
+	__m256 nextVal = _mm256_i32gather_ps(field.land, landIdx, 4);
+	__m256 nextShore = _mm256_i32gather_ps(field.shore, landIdx, 4);
+
+	__m256i key = _mm256_add_epi32(_mm256_cvttps_epi32(nx), _mm256_cvttps_epi32(_mm256_mul_ps(ny, width)));
+	__m256 inside = _mm256_and_ps(_mm256_and_ps(_mm256_cmp_ps(nx, zero, _CMP_GE_OQ), _mm256_cmp_ps(ny, zero, _CMP_GE_OQ)),
+		_mm256_and_ps(_mm256_cmp_ps(nx, width, _CMP_LE_OQ), _mm256_cmp_ps(ny, height, _CMP_LE_OQ)));
+	if (field.seen != nullptr)
+	{
+		// seen is bytes, so gather the 32 bits at each key and keep the low byte. Lanes off
+		// the map aren't read at all, and the padding covers the 3 bytes past the last key.
+		__m256i seen = _mm256_mask_i32gather_epi32(_mm256_setzero_si256(), (const int*)field.seen, key, _mm256_castps_si256(inside), 1);
+		__m256i unseen = _mm256_cmpeq_epi32(_mm256_and_si256(seen, _mm256_set1_epi32(0xff)), _mm256_setzero_si256());
+		inside = _mm256_and_ps(inside, _mm256_castsi256_ps(unseen));
+	}
+
+	_mm256_store_ps(out.x, nx);
+	_mm256_store_ps(out.y, ny);
+	_mm256_store_ps(out.cost, StepCost8(route, nx, ny, nextVal, nextShore));
+	_mm256_store_si256((__m256i*)out.key, key);
+	out.open = _mm256_movemask_ps(inside);
+}
+
+#endif
+
+typedef void (*ExpandKernel)(const StepCostField& field, const StepCostRoute& route, const float* stepX, const float* stepY, float x, float y, NeighbourBatch& out);
+
+struct NamedKernel
+{
+	const char* name;
+	ExpandKernel kernel;
+};
+
+static int GetKernels(NamedKernel* kernels)
+{
+	int count = 0;
+	kernels[count++] = NamedKernel{ "scalar", ExpandScalar };
+#if PATHCOST_SIMD
+	kernels[count++] = NamedKernel{ "SSE", ExpandSSE };
+	if (CpuHasAVX2())
+		kernels[count++] = NamedKernel{ "AVX2", ExpandAVX2 };
+#endif
+	return count;
+}
+
+static ExpandKernel PickExpandKernel()
+{
+	NamedKernel kernels[3];
+	int count = GetKernels(kernels);
+	return kernels[count - 1].kernel;
+}
+
+void ExpandNeighbours(const StepCostField& field, const StepCostRoute& route, const float* stepX, const float* stepY, float x, float y, NeighbourBatch& out)
+{
+	static ExpandKernel kernel = PickExpandKernel();
+	kernel(field, route, stepX, stepY, x, y, out);
+}
+
+void BenchmarkNeighbourCost(const float* land, const float* shore, int width, int height, float segDist, float shoreScale, const float* stepX, const float* stepY)
+{
+	// one route across the middle of the map, expanded from every lattice point on it,
+	// with every third key already seen so the mask gets some work too
+	ofPoint start(width * 0.1f, height * 0.5f);
+	ofPoint target(width * 0.9f, height * 0.5f);
+	StepCostRoute route(start, target, land[(int)start.x + (int)start.y * width], land[(int)target.x + (int)target.y * width], segDist, shoreScale);
+
+	vector<unsigned char> seen(SeenSize(width, height), 0);
+	for (int i = 0; i < seen.size(); i += 3)
+		seen[i] = 1;
+	StepCostField field = { land, shore, seen.data(), width, height };
+
+	vector<ofPoint> nodes;
+	for (float y = 0; y <= height; y += segDist)
+	{
+		for (float x = 0; x <= width; x += segDist)
+			nodes.push_back(ofPoint(x, y));
+	}
+
+	vector<NeighbourBatch> expected(nodes.size());
+	for (int n = 0; n < nodes.size(); n++)
+		ExpandScalar(field, route, stepX, stepY, nodes[n].x, nodes[n].y, expected[n]);
+
+	NamedKernel kernels[3];
+	int count = GetKernels(kernels);
+	float scalarTime = 0;
+	for (int k = 0; k < count; k++)
+	{
+		NeighbourBatch batch;
+		float checksum = 0;
+		std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+		for (int repeat = 0; repeat < benchmarkRepeats; repeat++)
+		{
+			for (auto& node : nodes)
+			{
+				kernels[k].kernel(field, route, stepX, stepY, node.x, node.y, batch);
+				checksum += batch.cost[batch.open & 7];
+			}
+		}
+		float elapsed = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+		if (k == 0)
+			scalarTime = elapsed;
+
+		int mismatches = 0;
+		for (int n = 0; n < nodes.size(); n++)
+		{
+			kernels[k].kernel(field, route, stepX, stepY, nodes[n].x, nodes[n].y, batch);
+			bool same = batch.open == expected[n].open
+				&& memcmp(batch.cost, expected[n].cost, sizeof(batch.cost)) == 0
+				&& memcmp(batch.key, expected[n].key, sizeof(batch.key)) == 0;
+			if (!same)
+				mismatches++;
+		}
+
+		float nodeNs = elapsed * 1000000.0f / (nodes.size() * benchmarkRepeats);
+		printf("Neighbour cost %-6s %6.1fns per node, %.2fx scalar, %d of %d nodes differ (checksum %g)\n",
+			kernels[k].name, nodeNs, scalarTime / elapsed, mismatches, (int)nodes.size(), checksum);
+	}
+}
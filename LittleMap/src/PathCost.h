@@ -0,0 +1,59 @@
+#pragma once
+#include "ofMain.h"
+
+// The parts of the A* step cost that only depend on the route, worked out once per route
+// instead of once per neighbour.
+struct StepCostRoute
+{
+	StepCostRoute(ofPoint start, ofPoint target, float startVal, float targetVal, float segDist, float shoreScale);
+
+	float targetX;
+	float targetY;
+	float startVal;
+	float targetVal;
+	float pathDist;
+	float lowPoint;
+	float highPoint;
+	float segDist;
+	float shoreScale;
+};
+
+// What the costs are read from. land and shore are width * height land values and distances
+// to the coast, as in CurveTerrain. seen is optional, one byte per key with 3 bytes of padding
+// at the end (see SeenSize).
+struct StepCostField
+{
+	const float* land;
+	const float* shore;
+	const unsigned char* seen;
+	int width;
+	int height;
+};
+
+// The eight neighbours of one node, a lane each.
+struct NeighbourBatch
+{
+	alignas(32) float x[8];
+	alignas(32) float y[8];
+	alignas(32) float cost[8];
+	// (int)x + (int)(y * width), the same key the open search uses for visited nodes
+	alignas(32) int key[8];
+	// bit i is set when neighbour i is on the map and not marked in seen
+	int open;
+};
+
+// Entries a seen array needs for any key on a width x height map.
+inline int SeenSize(int width, int height)
+{
+	return width * (height + 1) + 4;
+}
+
+// Same value as Paths::Cost, for a point whose land value and shore distance are already looked up.
+float StepCost(const StepCostRoute& route, float x, float y, float nextVal, float nextShore);
+
+// stepX and stepY are the eight neighbour offsets, already scaled by the step length.
+// Uses the widest kernel the CPU has.
+void ExpandNeighbours(const StepCostField& field, const StepCostRoute& route, const float* stepX, const float* stepY, float x, float y, NeighbourBatch& out);
+
+// Times every kernel against the scalar one over the whole field, and checks they agree.
+void BenchmarkNeighbourCost(const float* land, const float* shore, int width, int height, float segDist, float shoreScale, const float* stepX, const float* stepY);
@@ -1,12 +1,19 @@
 #include "Paths.h"
+#include "PolylineCursor.h"
+#include "Snapshot.h"
+#include "Simplify.h"
 
 #include <chrono>
+#include <cfloat>
 
 int numPaths = 4;
 int minNearest = 1;
 int maxNearest = 17;
 float pathSegDist = 10.0f;
 float shoreline = 0.0f;
+// shore cost is this over the pixels to the coast; about what the old land value based cost
+// came to on a coast of median slope
+float shoreCostScale = 200000.0f;
 float dotSize = 3;
 float dotSpacing = 10.0f;
 float dashSize = 2;
@@ -14,14 +21,35 @@ float dashLength = 7.0f;
 float dashSpacing = 10.0f;
 float dibbleSize = 2;
 float dibbleSpacing = 5.0f;
-float noDrawSpacingSq = 4.0f*4.0f;
-
-Paths::Paths(CurveTerrain &terrain, Landmarks &landmarks, int debugNum)
-	: landmarks(landmarks)
+float noDrawSpacing = 4.0f;
+float routeGridSize = 16.0f;
+const int curveResolution = 20;
+const int strokeSmoothing = 30;
+// Below and Mixed routes can use a bidirectional A* instead, with a step cost built from the
+// same terms as Cost() but never less than the distance walked, so distance is a safe lower bound.
+bool bidirectionalSeaRoutes = true;
+int plannerExpansionBudget = 6000;
+float plannerPenaltyScale = 2000.0f;
+// Routes first search a coarse graph of clusterNodes x clusterNodes lattice clusters,
+// then only search the clusters it went through, plus corridorMargin around them.
+bool hierarchicalRoutes = true;
+int clusterNodes = 10;
+int corridorMargin = 1;
+// Below and Mixed routes share one cost-to-go field per destination node over the corner lattice
+// instead, and each just walks downhill on its field. A field can't know where a route starts, so
+// its height preference is to the destination's height rather than a line between the ends,
+// so routes come out differently; off, they're planned one at a time as before.
+bool sharedRouteFields = false;
+
+Paths::Paths(Generator &generator, CurveTerrain &terrain, Landmarks &landmarks, int debugNum)
+	: generator(generator)
+	, landmarks(landmarks)
 	, terrain(terrain)
 	, debugNum(debugNum)
 	, nextMessage(nullptr)
 {
+	DependsOn(&terrain);
+	DependsOn(&landmarks);
 }
 
 Paths::~Paths()
@@ -38,6 +66,12 @@ void Paths::Setup()
 	offsets[5] = ofPoint(1.0f, -1.0f);
 	offsets[6] = ofPoint(0.0f, -1.0f);
 	offsets[7] = ofPoint(-1.0f, -1.0f);
+	for (int i = 0; i < 8; i++)
+	{
+		ofPoint step = offsets[i] * pathSegDist;
+		stepX[i] = step.x;
+		stepY[i] = step.y;
+	}
 
 	Reset();
 }
@@ -45,6 +79,7 @@ void Paths::Setup()
 void Paths::Reset()
 {
 	pathIdx = -1;
+	generated = false;
 	if (image.isAllocated())
 		image.clear();
 	image.allocate(ofGetWidth(), ofGetHeight(), GL_RGBA);
@@ -60,28 +95,20 @@ void Paths::Reset()
 	debugImage.end();
 
 	paths.clear();
+	arena.Release();
 	drawnPaths.clear();
+	routeGrid.Setup(ofGetWidth(), ofGetHeight(), routeGridSize);
+	navGraph.Clear();
+	routeFields.clear();
 }
 
-void Paths::DrawRoute(ofPolyline stroke, Paths::PathStyle style, bool testOverlap)
+void Paths::DrawRoute(const ofPolyline& stroke, Paths::PathStyle style, SpatialGrid* overlapGrid)
 {
-	float len = 0;
-	while (stroke.getIndexAtLength(len) < stroke.size()-1) // apparently size - 1....
+	PolylineCursor cursor(stroke);
+	while (!cursor.Done())
 	{
-		ofPoint pt = stroke.getPointAtLength(len);
-		bool blocked = false;
-		if (testOverlap)
-		{
-			for (auto otherLine : drawnPaths)
-			{
-				ofPoint otherPt = otherLine.getClosestPoint(pt);
-				if (pt.distanceSquared(otherPt) < noDrawSpacingSq)
-				{
-					blocked = true;
-					break;
-				}
-			}
-		}
+		ofPoint pt = cursor.GetPoint();
+		bool blocked = overlapGrid != nullptr && overlapGrid->Near(pt, noDrawSpacing);
 		
 		if (!blocked)
 		{
@@ -97,7 +124,8 @@ void Paths::DrawRoute(ofPolyline stroke, Paths::PathStyle style, bool testOverla
 			}
 			else if (style == PathStyle::Mixed)
 			{
-				if (terrain.GetLandValue(pt.x, pt.y) > 0)
+				// interpolated, so the dashes change where the coast is drawn rather than a pixel off
+				if (terrain.SampleLand(pt.x, pt.y).value > 0)
 					ofSetColor(ofColor::black);
 				else
 					ofSetColor(0, 0, 0, 150);
@@ -106,52 +134,114 @@ void Paths::DrawRoute(ofPolyline stroke, Paths::PathStyle style, bool testOverla
 		}
 		if (style == PathStyle::Below)
 		{
-			len += dotSpacing;
+			cursor.Advance(dotSpacing);
 		}
 		else if (style == PathStyle::Above)
 		{
-			len += dibbleSpacing;
+			cursor.Advance(dibbleSpacing);
 		}
 		else if (style == PathStyle::Mixed)
 		{
-			float phase = std::fmodf(len, (dashLength + dashSpacing));
+			float phase = std::fmodf(cursor.GetLength(), (dashLength + dashSpacing));
 			if (phase < dashLength)
-				len += 3;
+				cursor.Advance(3);
 			else
-				len += dashSpacing;
+				cursor.Advance(dashSpacing);
 		}
 	}
 
 }
 
-void Paths::TracePath(Path& path)
+// Same points ofPolyline::curveTo would make: curveResolution per span, t running 0..1 inclusive.
+void CurveThrough(const vector<ofPoint>& control, vector<ofPoint>& out)
 {
-	ofPolyline stroke = ofPolyline();
+	out.clear();
+	if (control.size() < 4)
+		return;
+	out.reserve((control.size() - 3) * curveResolution);
 
-	stroke.curveTo(path.progress.visited[path.progress.currentIndex].pos);
-	stroke.curveTo(path.progress.visited[path.progress.currentIndex].pos);
+	for (int k = 0; k + 3 < control.size(); k++)
+	{
+		const ofPoint& p0 = control[k];
+		const ofPoint& p1 = control[k + 1];
+		const ofPoint& p2 = control[k + 2];
+		const ofPoint& p3 = control[k + 3];
+		for (int i = 0; i < curveResolution; i++)
+		{
+			float t = (float)i / (float)(curveResolution - 1);
+			float t2 = t * t;
+			float t3 = t2 * t;
+			float x = 0.5f * ((2.0f * p1.x) + (-p0.x + p2.x) * t + (2.0f * p0.x - 5.0f * p1.x + 4 * p2.x - p3.x) * t2 + (-p0.x + 3.0f * p1.x - 3.0f * p2.x + p3.x) * t3);
+			float y = 0.5f * ((2.0f * p1.y) + (-p0.y + p2.y) * t + (2.0f * p0.y - 5.0f * p1.y + 4 * p2.y - p3.y) * t2 + (-p0.y + 3.0f * p1.y - 3.0f * p2.y + p3.y) * t3);
+			out.push_back(ofPoint(x, y));
+		}
+	}
+}
 
-	while (path.progress.visited[path.progress.currentIndex].parent != -1)
+// getSmoothed(size, 1) is an unweighted average over size-1 points either side, cut short at the ends.
+// Running sums give the same thing in one pass, written back over the input.
+void BoxSmooth(vector<ofPoint>& points, int size, vector<double>& sums)
+{
+	int n = points.size();
+	sums.resize((n + 1) * 2);
+	sums[0] = 0;
+	sums[1] = 0;
+	for (int i = 0; i < n; i++)
 	{
-		stroke.curveTo(path.progress.visited[path.progress.visited[path.progress.currentIndex].parent].pos);
-		path.progress.currentIndex = path.progress.visited[path.progress.currentIndex].parent;
+		sums[(i + 1) * 2] = sums[i * 2] + points[i].x;
+		sums[(i + 1) * 2 + 1] = sums[i * 2 + 1] + points[i].y;
+	}
+
+	int reach = size - 1;
+	for (int i = 0; i < n; i++)
+	{
+		int first = std::max(0, i - reach);
+		int last = std::min(n - 1, i + reach);
+		double count = last - first + 1;
+		points[i].x = (sums[(last + 1) * 2] - sums[first * 2]) / count;
+		points[i].y = (sums[(last + 1) * 2 + 1] - sums[first * 2 + 1]) / count;
+	}
+}
+
+// The CPU half of TracePath: follows the route back and builds its stroke into drawnPaths.
+void Paths::BuildStroke(Path& path)
+{
+	// control points from the end back to the start, with the ends doubled up so the curve reaches them
+	controlPoints.clear();
+	const pathBit* bit = &path.progress.visited[path.progress.currentIndex];
+	controlPoints.push_back(bit->pos);
+	controlPoints.push_back(bit->pos);
+	while (bit->parent != -1)
+	{
+		path.progress.currentIndex = bit->parent;
+		bit = &path.progress.visited[bit->parent];
+		controlPoints.push_back(bit->pos);
 		path.progress.length++;
 	}
+	controlPoints.push_back(bit->pos);
+	controlPoints.push_back(bit->pos);
 
-	stroke.curveTo(path.progress.visited[path.progress.currentIndex].pos);
-	stroke.curveTo(path.progress.visited[path.progress.currentIndex].pos);
+	// built straight into drawnPaths, so the stroke is never copied
+	drawnPaths.push_back(ofPolyline());
+	ofPolyline& stroke = drawnPaths.back();
+	CurveThrough(controlPoints, stroke.getVertices());
+	BoxSmooth(stroke.getVertices(), strokeSmoothing, smoothingSums);
 
-	stroke = stroke.getSmoothed(30, 1);
+	path.progress.traced = true;
+	printf("\t%d length\n", path.progress.length);
+}
+
+void Paths::TracePath(Path& path)
+{
+	BuildStroke(path);
+	const ofPolyline& stroke = drawnPaths.back();
 
 	ofFill();
 	ofEnableSmoothing();
 
-	DrawRoute(stroke, path.style, true);
+	DrawRoute(stroke, path.style, &routeGrid);
 
-	drawnPaths.push_back(stroke);
-
-	path.progress.traced = true;
-	printf("\t%d length\n", path.progress.length);
+	routeGrid.AddPolyline(stroke);
 }
 
 bool Paths::DoRender()
@@ -163,7 +253,10 @@ bool Paths::DoRender()
 	}
 	else if (path.progress.found == false)
 	{
-		FindPath(path);
+		if (path.progress.bidirectional)
+			StepBidirectional(path);
+		else
+			FindPath(path);
 	}
 	else if (path.progress.traced == false)
 	{
@@ -182,7 +275,7 @@ void Paths::DebugRender()
 {
 	Path& path = paths[pathIdx];
 
-	for (std::map<int, pathBit>::iterator it = path.progress.visited.begin(); it != path.progress.visited.end(); it++)
+	for (visitedMap::iterator it = path.progress.visited.begin(); it != path.progress.visited.end(); it++)
 	{
 		if (it->second.parent == -1)
 			continue;
@@ -194,7 +287,7 @@ void Paths::DebugRender()
 		ofDrawLine(it->second.pos, path.progress.visited[it->second.parent].pos);
 	}
 
-	for (std::list<int>::iterator it = path.progress.open.begin(); it != path.progress.open.end(); it++)
+	for (openList::iterator it = path.progress.open.begin(); it != path.progress.open.end(); it++)
 	{
 		if (it == path.progress.open.begin())
 		{
@@ -217,7 +310,7 @@ void Paths::RenderCosts()
 {
 	Path& path = paths[pathIdx];
 
-	for (std::map<int, pathBit>::iterator it = path.progress.visited.begin(); it != path.progress.visited.end(); it++)
+	for (visitedMap::iterator it = path.progress.visited.begin(); it != path.progress.visited.end(); it++)
 	{
 		if (it->second.parent == -1)
 			continue;
@@ -327,40 +420,164 @@ void Paths::RenderCosts()
 		}
 	}
 
+	if (debugNum == 9)
+	{
+		navGraph.DebugDraw(path.progress.corridor);
+		nextMessage = "Nav graph corridor";
+	}
+
 	ofSetLineWidth(3);
 	ofSetColor(255, 0, 255, 255);
 	ofDrawLine(path.start, path.end);
 	ofSetLineWidth(1);
 }
 
-bool Paths::Render()
+void Paths::PickPaths()
 {
-	if (pathIdx == -1)
+	rng = generator.GetStream(Generator::StreamPaths);
+	for (int i = 0; i < numPaths; i++)
 	{
-		for (int i = 0; i < numPaths; i++)
+		Landmarks::Landmark start = landmarks.GetRandomLandmark(rng);
+		int r = rng.Int(maxNearest - minNearest) + minNearest;
+		Landmarks::Landmark end = landmarks.GetNthClosestLandmark(start, r);
+		if (start.pos.x < 0 || start.pos.y < 0 || start.pos.x > ofGetWidth() || start.pos.y > ofGetHeight()
+			|| end.pos.x < 0 || end.pos.y < 0 || end.pos.x > ofGetWidth() || end.pos.y > ofGetHeight())
 		{
-			Landmarks::Landmark start = landmarks.GetRandomLandmark();
-			int r = (std::rand() % (maxNearest - minNearest)) + minNearest;
-			Landmarks::Landmark end = landmarks.GetNthClosestLandmark(start, r);
-			if (start.pos.x < 0 || start.pos.y < 0 || start.pos.x > ofGetWidth() || start.pos.y > ofGetHeight()
-				|| end.pos.x < 0 || end.pos.y < 0 || end.pos.x > ofGetWidth() || end.pos.y > ofGetHeight())
-			{
-				i--;
+			i--;
+			continue;
+		}
+		bool startLand = terrain.GetLandValue(start.pos.x, start.pos.y) > 0;
+		bool endLand = terrain.GetLandValue(end.pos.x, end.pos.y) > 0;
+		PathStyle style;
+		if (!startLand && !endLand)
+			style = PathStyle::Below;
+		else if (startLand != endLand)
+			style = PathStyle::Mixed;
+		else
+			style = rng.Float() < 0.5f ? PathStyle::Above : PathStyle::Below;
+
+		Path p = { start.pos, end.pos, style };
+		paths.push_back(p);
+	}
+
+	drawnPaths.reserve(paths.size());
+
+	BuildLattice();
+	if (hierarchicalRoutes)
+		navGraph.Build(latticeWidth, latticeHeight, pathSegDist, clusterNodes, latticeShore);
+
+	if (sharedRouteFields)
+	{
+		// each route's field goes at whichever of its ends more routes share
+		std::map<int, int> ends;
+		for (auto& path : paths)
+		{
+			if (path.style == PathStyle::Above)
 				continue;
-			}
-			bool startLand = terrain.GetLandValue(start.pos.x, start.pos.y) > 0;
-			bool endLand = terrain.GetLandValue(end.pos.x, end.pos.y) > 0;
-			PathStyle style;
-			if (!startLand && !endLand)
-				style = PathStyle::Below;
-			else if (startLand != endLand)
-				style = PathStyle::Mixed;
-			else
-				style = ofRandom(0.0f, 1.0f) < 0.5f ? PathStyle::Above : PathStyle::Below;
+			ends[LatticeNode(path.start)]++;
+			ends[LatticeNode(path.end)]++;
+		}
+		for (auto& path : paths)
+			path.traceFromEnd = path.style != PathStyle::Above && ends[LatticeNode(path.start)] > ends[LatticeNode(path.end)];
+	}
+}
+
+// Finds and traces one route per call, on the worker. The debug views watch the search
+// step by step, so with one of those up everything stays in Render instead.
+bool Paths::Generate()
+{
+	if (pathIdx == -1)
+	{
+		if (debugNum > 0)
+			return true;
+
+		PickPaths();
+		generated = true;
+		pathIdx = 0;
+		return false;
+	}
+	if (!generated || pathIdx >= paths.size())
+		return true;
+
+	Path& path = paths[pathIdx];
+	SetupPath(path);
+	while (!path.progress.found)
+	{
+		if (path.progress.bidirectional)
+			StepBidirectional(path);
+		else if (!path.progress.open.empty())
+			FindPath(path);
+		else
+			break; // nowhere left to look, trace what we've got
+	}
+	BuildStroke(path);
+
+	pathIdx++;
+	return pathIdx >= paths.size();
+}
+
+// Just the finished strokes; the searches that made them aren't worth keeping.
+bool Paths::WriteSnapshot(SnapshotWriter& out)
+{
+	if (!generated || drawnPaths.size() != paths.size())
+		return false;
 
-			Path p = { start.pos, end.pos, style };
-			paths.push_back(p);
+	out.Write((int)paths.size());
+	for (int i = 0; i < paths.size(); i++)
+	{
+		out.Write(paths[i].start);
+		out.Write(paths[i].end);
+		out.Write(paths[i].style);
+		out.WritePolyline(drawnPaths[i]);
+	}
+	return true;
+}
+
+bool Paths::ReadSnapshot(SnapshotReader& in)
+{
+	int count;
+	if (debugNum > 0 || !in.ReadCount(count, sizeof(ofPoint) * 2 + sizeof(PathStyle) + SnapshotReader::minPolylineBytes))
+		return false;
+
+	paths.resize(count);
+	drawnPaths.resize(count);
+	for (int i = 0; i < count; i++)
+	{
+		// read as a plain int, so a bad style is caught before it's ever a PathStyle
+		int style;
+		static_assert(sizeof(style) == sizeof(PathStyle), "styles are written as they are in memory");
+		if (!in.Read(paths[i].start) || !in.Read(paths[i].end) || !in.Read(style)
+			|| style < Below || style > Mixed || !in.ReadPolyline(drawnPaths[i]))
+			return false;
+		paths[i].style = (PathStyle)style;
+	}
+
+	generated = true;
+	pathIdx = count;
+	return true;
+}
+
+bool Paths::Render()
+{
+	if (generated)
+	{
+		// Generate found and traced every route, all that's left is drawing them
+		image.begin();
+		ofClear(0, 0, 0, 0);
+		ofFill();
+		ofEnableSmoothing();
+		for (int i = 0; i < drawnPaths.size(); i++)
+		{
+			DrawRoute(drawnPaths[i], paths[i].style, &routeGrid);
+			routeGrid.AddPolyline(drawnPaths[i]);
 		}
+		image.end();
+		return true;
+	}
+
+	if (pathIdx == -1)
+	{
+		PickPaths();
 
 		debugImage.begin();
 		ofClear(0, 0, 0, 0);
@@ -419,6 +636,34 @@ void Paths::Draw()
 		image.draw(0, 0);
 }
 
+// The strokes traced in Generate, with the detail that wouldn't show at this scale taken out,
+// drawn over again the way Render drew them.
+void Paths::DrawLevel(float scale)
+{
+	if (!generated)
+	{
+		Stage::DrawLevel(scale);
+		return;
+	}
+
+	ofPushMatrix();
+	ofScale(scale, scale);
+	ofFill();
+	ofEnableSmoothing();
+	// its own grid, so exporting doesn't touch the map's
+	SpatialGrid levelGrid;
+	levelGrid.Setup(ofGetWidth(), ofGetHeight(), routeGridSize);
+	ofPolyline simplified;
+	for (int i = 0; i < drawnPaths.size(); i++)
+	{
+		// half a pixel at this scale
+		SimplifyDouglasPeucker(drawnPaths[i].getVertices(), 0.5f / scale, simplified.getVertices());
+		DrawRoute(simplified, paths[i].style, &levelGrid);
+		levelGrid.AddPolyline(drawnPaths[i]);
+	}
+	ofPopMatrix();
+}
+
 void Paths::DebugNum(int key)
 {
 	debugNum = key - '0';
@@ -451,6 +696,16 @@ void Paths::GetCosts(ofPoint pos, float& valCost, float& distCost, float& totalC
 	Cost(paths[pathIdx].start, pos, paths[pathIdx].end, valCost, distCost, totalCost, shoreCost);
 }
 
+void Paths::BenchmarkExpansion()
+{
+	BenchmarkNeighbourCost(terrain.GetLandValues(), terrain.GetShoreDistances(), ofGetWidth(), ofGetHeight(), pathSegDist, shoreCostScale, stepX, stepY);
+}
+
+float ShoreCost(float shoreDist)
+{
+	return std::min(std::abs(shoreCostScale / shoreDist), 10000.0f);
+}
+
 float Paths::Cost(ofPoint start, ofPoint next, ofPoint target, float& valCost, float& distCost, float& totalCost, float& shoreCost)
 {
 	float startVal = terrain.GetLandValue(start.x, start.y);
@@ -478,29 +733,18 @@ float Paths::Cost(ofPoint start, ofPoint next, ofPoint target, float& valCost, f
 		distCost += outerPart * outerPart;
 	}
 
-	float shoreDist = std::abs(1 / (nextVal * 100.0f));
-	/*float*/ shoreCost = std::min(shoreDist * 50000.0f, 10000.0f);
+	/*float*/ shoreCost = ShoreCost(terrain.GetShoreDistance(next.x, next.y));
 	/*float*/ totalCost = distCost + valCost + shoreCost;
 	return totalCost;
 }
 
-
-float Paths::Cost(ofPoint start, ofPoint next, ofPoint target)
-{
-	float valCost;
-	float distCost;
-	float totalCost;
-	float shoreCost;
-	return Cost(start, next, target, valCost, distCost, totalCost, shoreCost);
-}
-
 void Paths::SetupPath(Path& path)
 {
 	path.progress.currentPos = path.start;
 	path.progress.currentIndex = (int)path.start.x + (int)(path.start.y * ofGetWidth());
 
-	path.progress.visited = std::map<int, pathBit>();
-	path.progress.open = std::list<int>();
+	path.progress.visited = visitedMap(std::less<int>(), ArenaAllocator<int>(&arena));
+	path.progress.open = openList(ArenaAllocator<int>(&arena));
 	path.progress.open.push_back(path.progress.currentIndex);
 	pathBit startBit = {
 		1000000,
@@ -515,6 +759,247 @@ void Paths::SetupPath(Path& path)
 
 	path.progress.length = 0;
 	path.progress.traced = false;
+
+	path.progress.bidirectional = false;
+	path.progress.corridor.clear();
+	if (sharedRouteFields && path.style != PathStyle::Above)
+	{
+		FollowRouteField(path);
+		return;
+	}
+
+	if (navGraph.IsBuilt())
+	{
+		// the shore part of Cost() is already in the graph, add this route's height preference
+		vector<float> extraPenalty(navGraph.GetPortalCount());
+		for (int i = 0; i < extraPenalty.size(); i++)
+		{
+			float valCost;
+			float distCost;
+			float totalCost;
+			float shoreCost;
+			Cost(path.start, navGraph.GetPortalPos(i), path.end, valCost, distCost, totalCost, shoreCost);
+			extraPenalty[i] = valCost / plannerPenaltyScale;
+		}
+		if (!navGraph.FindCorridor(path.start, path.end, extraPenalty, corridorMargin, path.progress.corridor))
+			path.progress.corridor.clear();
+	}
+
+	if (bidirectionalSeaRoutes && path.style != PathStyle::Above)
+	{
+		SetupBidirectional(path);
+	}
+	else
+	{
+		seen.assign(SeenSize(ofGetWidth(), ofGetHeight()), 0);
+		seen[path.progress.currentIndex] = 1;
+	}
+}
+
+ofPoint Paths::NodePos(progress& state, int node)
+{
+	return state.latticeOrigin + ofPoint(node % state.latticeWidth, node / state.latticeWidth) * pathSegDist;
+}
+
+float Paths::StepPenalty(Path& path, int node)
+{
+	float& penalty = path.progress.penalty[node];
+	if (penalty < 0)
+	{
+		float valCost;
+		float distCost;
+		float totalCost;
+		float shoreCost;
+		Cost(path.start, NodePos(path.progress, node), path.end, valCost, distCost, totalCost, shoreCost);
+		penalty = (valCost + shoreCost) / plannerPenaltyScale;
+	}
+	return penalty;
+}
+
+void Paths::SetupBidirectional(Path& path)
+{
+	progress& state = path.progress;
+	state.bidirectional = true;
+
+	int left = (int)std::floor(path.start.x / pathSegDist);
+	int up = (int)std::floor(path.start.y / pathSegDist);
+	state.latticeOrigin = path.start - ofPoint(left, up) * pathSegDist;
+	state.latticeWidth = (int)std::floor((ofGetWidth() - state.latticeOrigin.x) / pathSegDist) + 1;
+	state.latticeHeight = (int)std::floor((ofGetHeight() - state.latticeOrigin.y) / pathSegDist) + 1;
+	state.startNode = up * state.latticeWidth + left;
+
+	// the end is usually between nodes, so aim for the nearest one and step off it at the end
+	int goalX = ofClamp((int)std::round((path.end.x - state.latticeOrigin.x) / pathSegDist), 0, state.latticeWidth - 1);
+	int goalY = ofClamp((int)std::round((path.end.y - state.latticeOrigin.y) / pathSegDist), 0, state.latticeHeight - 1);
+	state.goalNode = goalY * state.latticeWidth + goalX;
+
+	int count = state.latticeWidth * state.latticeHeight;
+	state.penalty = ArenaVector<float>(count, -1.0f, &arena);
+	searchSide* sides[2] = { &state.forward, &state.backward };
+	for (searchSide* side : sides)
+	{
+		side->spend = ArenaVector<float>(count, FLT_MAX, &arena);
+		side->parent = ArenaVector<int>(count, -1, &arena);
+		side->closed = ArenaVector<bool>(count, false, &arena);
+		side->open = decltype(side->open)();
+		side->closest = -1;
+		side->closestDist = FLT_MAX;
+	}
+
+	// Each side aims at the node the other starts from, not the route's end, which the goal node
+	// is only snapped to; the straight line is then never more than the lattice route costs.
+	ofPoint startPos = NodePos(state, state.startNode);
+	ofPoint goalPos = NodePos(state, state.goalNode);
+	state.forward.spend[state.startNode] = 0;
+	state.forward.open.push(std::make_pair(startPos.distance(goalPos), state.startNode));
+	state.backward.spend[state.goalNode] = 0;
+	state.backward.open.push(std::make_pair(goalPos.distance(startPos), state.goalNode));
+
+	state.meetNode = -1;
+	state.meetCost = FLT_MAX;
+	if (state.startNode == state.goalNode)
+	{
+		state.meetNode = state.startNode;
+		state.meetCost = 0;
+	}
+}
+
+bool Paths::ExpandSide(Path& path, searchSide& side, searchSide& other, ofPoint target)
+{
+	const float sqrt2 = 1.41421356f;
+	progress& state = path.progress;
+
+	while (!side.open.empty())
+	{
+		int node = side.open.top().second;
+		side.open.pop();
+		if (side.closed[node])
+			continue; // stale entry, it was reached more cheaply since
+
+		side.closed[node] = true;
+		state.iteration++;
+
+		float dist = NodePos(state, node).distance(target);
+		if (dist < side.closestDist)
+		{
+			side.closestDist = dist;
+			side.closest = node;
+		}
+
+		int nx = node % state.latticeWidth;
+		int ny = node / state.latticeWidth;
+		for (int i = 0; i < 8; i++)
+		{
+			int mx = nx + (int)offsets[i].x;
+			int my = ny + (int)offsets[i].y;
+			if (mx < 0 || my < 0 || mx >= state.latticeWidth || my >= state.latticeHeight)
+				continue;
+
+			int next = my * state.latticeWidth + mx;
+			if (side.closed[next] || !navGraph.InCorridor(state.corridor, NodePos(state, next)))
+				continue;
+
+			// the same both ways, so the two sides agree on what a route costs
+			float stepLength = (offsets[i].x != 0 && offsets[i].y != 0 ? sqrt2 : 1.0f) * pathSegDist;
+			float spend = side.spend[node] + stepLength * (1.0f + (StepPenalty(path, node) + StepPenalty(path, next)) * 0.5f);
+			if (spend >= side.spend[next])
+				continue;
+
+			side.spend[next] = spend;
+			side.parent[next] = node;
+			side.open.push(std::make_pair(spend + NodePos(state, next).distance(target), next));
+
+			if (other.spend[next] < FLT_MAX && spend + other.spend[next] < state.meetCost)
+			{
+				state.meetCost = spend + other.spend[next];
+				state.meetNode = next;
+			}
+		}
+		return true;
+	}
+	return false;
+}
+
+void Paths::StepBidirectional(Path& path)
+{
+	progress& state = path.progress;
+	float forwardMin = state.forward.open.empty() ? FLT_MAX : state.forward.open.top().first;
+	float backwardMin = state.backward.open.empty() ? FLT_MAX : state.backward.open.top().first;
+
+	// nothing left on either frontier can beat the route through meetNode
+	bool done = state.meetNode != -1 && (forwardMin >= state.meetCost || backwardMin >= state.meetCost);
+	bool stuck = state.forward.open.empty() || state.backward.open.empty();
+	bool outOfBudget = state.iteration >= plannerExpansionBudget;
+	if (done || stuck || outOfBudget)
+	{
+		if (!done)
+		{
+			printf("Bidirectional search %s after %d iterations, using the best %s route\n",
+				stuck ? "ran dry" : "hit its budget", state.iteration, state.meetNode != -1 ? "found" : "partial");
+		}
+		FinishBidirectional(path);
+		return;
+	}
+
+	// grow whichever frontier is smaller
+	if (state.forward.open.size() <= state.backward.open.size())
+		ExpandSide(path, state.forward, state.backward, NodePos(state, state.goalNode));
+	else
+		ExpandSide(path, state.backward, state.forward, NodePos(state, state.startNode));
+}
+
+void Paths::FinishBidirectional(Path& path)
+{
+	progress& state = path.progress;
+
+	// lattice nodes from start to goal
+	vector<int> route;
+	if (state.meetNode != -1)
+	{
+		for (int n = state.meetNode; n != -1; n = state.forward.parent[n])
+			route.push_back(n);
+		std::reverse(route.begin(), route.end());
+		for (int n = state.backward.parent[state.meetNode]; n != -1; n = state.backward.parent[n])
+			route.push_back(n);
+	}
+	else if (state.forward.closestDist <= state.backward.closestDist)
+	{
+		// the forward side got closer, follow it and cut straight across the rest
+		for (int n = state.forward.closest; n != -1; n = state.forward.parent[n])
+			route.push_back(n);
+		std::reverse(route.begin(), route.end());
+	}
+	else
+	{
+		// the backward side got closer, cut straight across to it
+		route.push_back(state.startNode);
+		for (int n = state.backward.closest; n != -1; n = state.backward.parent[n])
+			route.push_back(n);
+	}
+	if (route.empty())
+		route.push_back(state.startNode);
+
+	// lay it out the way TracePath expects, a chain of parents back to the start
+	state.visited.clear();
+	state.open.clear();
+	int parent = -1;
+	for (int i = 0; i < route.size(); i++)
+	{
+		pathBit bit = { 0, (float)i, NodePos(state, route[i]), parent };
+		state.visited.insert_or_assign(i, bit);
+		parent = i;
+	}
+	if (state.visited[parent].pos != path.end)
+	{
+		pathBit lastBit = { 0, (float)route.size(), path.end, parent };
+		parent = route.size();
+		state.visited.insert_or_assign(parent, lastBit);
+	}
+
+	state.currentIndex = parent;
+	state.currentPos = path.end;
+	state.found = true;
+	printf("%s path with %d iterations\n", state.meetNode != -1 ? "Found" : "Partial", state.iteration);
 }
 
 void Paths::FindPath(Path& path)
@@ -572,40 +1057,187 @@ void Paths::FindPath(Path& path)
 
 		path.progress.iteration++;
 
+		// all eight neighbours at once; open leaves out the ones off the map or already visited
+		StepCostField field = { terrain.GetLandValues(), terrain.GetShoreDistances(), seen.data(), ofGetWidth(), ofGetHeight() };
+		StepCostRoute route(path.start, path.end,
+			terrain.GetLandValue(path.start.x, path.start.y), terrain.GetLandValue(path.end.x, path.end.y), pathSegDist, shoreCostScale);
+		NeighbourBatch batch;
+		ExpandNeighbours(field, route, stepX, stepY, path.progress.currentPos.x, path.progress.currentPos.y, batch);
+
 		for (int i = 0; i < 8; i++)
 		{
-			ofPoint test = path.progress.currentPos + offsets[i] * pathSegDist;
-			float cost = Cost(path.start, test, path.end);
+			if ((batch.open & (1 << i)) == 0)
+				continue;
 
-			if (test.x < 0 || test.y < 0 || test.x > ofGetWidth() || test.y > ofGetHeight())
-			{
+			ofPoint test(batch.x[i], batch.y[i]);
+			if (!navGraph.InCorridor(path.progress.corridor, test))
 				continue;
-				//cost *= 4;
-			}
 
-			int visitedIndex = (int)test.x + (int)(test.y * ofGetWidth());
 			pathBit newBit = {
-				cost,
+				batch.cost[i],
 				currentSpend + 1,
 				test,
 				path.progress.currentIndex
 			};
-			if (path.progress.visited.find(visitedIndex) != path.progress.visited.end())
+			seen[batch.key[i]] = 1;
+			path.progress.visited.insert_or_assign(batch.key[i], newBit);
+			path.progress.open.push_back(batch.key[i]);
+		}
+	}
+	else
+	{
+		printf("%s path with %d iterations\n", path.progress.found ? "Found" : "Didn't find", path.progress.iteration);
+	}
+}
+
+void Paths::BuildLattice()
+{
+	// the same spacing the searches use, anchored at the corner so every route shares it
+	latticeWidth = (int)std::floor(ofGetWidth() / pathSegDist) + 1;
+	latticeHeight = (int)std::floor(ofGetHeight() / pathSegDist) + 1;
+	latticeLand.resize(latticeWidth * latticeHeight);
+	latticeShore.resize(latticeWidth * latticeHeight);
+	for (int y = 0; y < latticeHeight; y++)
+	{
+		for (int x = 0; x < latticeWidth; x++)
+		{
+			latticeLand[x + y * latticeWidth] = terrain.GetLandValue(x * pathSegDist, y * pathSegDist);
+			latticeShore[x + y * latticeWidth] = ShoreCost(terrain.GetShoreDistance(x * pathSegDist, y * pathSegDist)) / plannerPenaltyScale;
+		}
+	}
+}
+
+int Paths::LatticeNode(ofPoint pos)
+{
+	int x = ofClamp((int)std::round(pos.x / pathSegDist), 0, latticeWidth - 1);
+	int y = ofClamp((int)std::round(pos.y / pathSegDist), 0, latticeHeight - 1);
+	return x + y * latticeWidth;
+}
+
+const vector<float>& Paths::GetRouteField(int goal)
+{
+	for (auto& field : routeFields)
+	{
+		if (field.goal == goal)
+			return field.cost;
+	}
+
+	std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+	// the step cost of Cost(), measured against the goal's height alone
+	vector<float> penalty(latticeWidth * latticeHeight);
+	float goalVal = latticeLand[goal];
+	for (int i = 0; i < penalty.size(); i++)
+		penalty[i] = std::abs(latticeLand[i] - goalVal) * pathSegDist * 4000.0f / plannerPenaltyScale + latticeShore[i];
+
+	routeFields.push_back(RouteField{ goal, vector<float>(latticeWidth * latticeHeight, FLT_MAX) });
+	vector<float>& cost = routeFields.back().cost;
+
+	const float sqrt2 = 1.41421356f;
+	typedef std::pair<float, int> entry;
+	std::priority_queue<entry, vector<entry>, std::greater<entry>> open;
+	cost[goal] = 0;
+	open.push(entry(0, goal));
+	while (!open.empty())
+	{
+		entry top = open.top();
+		open.pop();
+		int node = top.second;
+		if (top.first > cost[node])
+			continue;
+
+		int nx = node % latticeWidth;
+		int ny = node / latticeWidth;
+		for (int i = 0; i < 8; i++)
+		{
+			int mx = nx + (int)offsets[i].x;
+			int my = ny + (int)offsets[i].y;
+			if (mx < 0 || my < 0 || mx >= latticeWidth || my >= latticeHeight)
+				continue;
+
+			int next = mx + my * latticeWidth;
+			float stepLength = (offsets[i].x != 0 && offsets[i].y != 0 ? sqrt2 : 1.0f) * pathSegDist;
+			float spend = cost[node] + stepLength * (1.0f + (penalty[node] + penalty[next]) * 0.5f);
+			if (spend < cost[next])
 			{
-				//if (path.progress.visited[visitedIndex].cost > cost)
-				//{
-				//	path.progress.visited.insert_or_assign(visitedIndex, newBit);
-				//}
+				cost[next] = spend;
+				open.push(entry(spend, next));
 			}
-			else
+		}
+	}
+
+	float elapsed = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+	printf("Built route field %d to node %d in %.2fms\n", (int)routeFields.size(), goal, elapsed);
+	return cost;
+}
+
+void Paths::FollowRouteField(Path& path)
+{
+	progress& state = path.progress;
+	ofPoint from = path.traceFromEnd ? path.end : path.start;
+	ofPoint to = path.traceFromEnd ? path.start : path.end;
+	int goal = LatticeNode(to);
+	const vector<float>& cost = GetRouteField(goal);
+
+	// steepest way downhill from the far end. Every node but the goal has a neighbour that's
+	// lower (the one it was reached from), so the walk always gets there and can't loop.
+	const float sqrt2 = 1.41421356f;
+	vector<int> route;
+	int node = LatticeNode(from);
+	route.push_back(node);
+	while (node != goal && route.size() <= cost.size())
+	{
+		int nx = node % latticeWidth;
+		int ny = node / latticeWidth;
+		int best = -1;
+		float bestSlope = 0;
+		for (int i = 0; i < 8; i++)
+		{
+			int mx = nx + (int)offsets[i].x;
+			int my = ny + (int)offsets[i].y;
+			if (mx < 0 || my < 0 || mx >= latticeWidth || my >= latticeHeight)
+				continue;
+
+			int next = mx + my * latticeWidth;
+			float stepLength = (offsets[i].x != 0 && offsets[i].y != 0 ? sqrt2 : 1.0f) * pathSegDist;
+			float slope = (cost[next] - cost[node]) / stepLength;
+			if (slope < bestSlope)
 			{
-				path.progress.visited.insert_or_assign(visitedIndex, newBit);
-				path.progress.open.push_back(visitedIndex);
+				bestSlope = slope;
+				best = next;
 			}
 		}
+		if (best == -1)
+			break;
+		node = best;
+		route.push_back(node);
 	}
-	else
+	state.iteration = route.size();
+
+	// points from the start to the end, stepping on and off the lattice at the ends
+	vector<ofPoint> points;
+	points.push_back(from);
+	for (int n : route)
+		points.push_back(ofPoint(n % latticeWidth, n / latticeWidth) * pathSegDist);
+	points.push_back(to);
+	if (path.traceFromEnd)
+		std::reverse(points.begin(), points.end());
+
+	// lay it out the way TracePath expects, a chain of parents back to the start
+	state.visited.clear();
+	state.open.clear();
+	int parent = -1;
+	for (int i = 0; i < points.size(); i++)
 	{
-		printf("%s path with %d iterations\n", path.progress.found ? "Found" : "Didn't find", path.progress.iteration);
+		if (parent != -1 && state.visited[parent].pos == points[i])
+			continue;
+		int index = parent + 1;
+		pathBit bit = { 0, (float)index, points[i], parent };
+		state.visited.insert_or_assign(index, bit);
+		parent = index;
 	}
+
+	state.currentIndex = parent;
+	state.currentPos = path.end;
+	state.found = true;
 }
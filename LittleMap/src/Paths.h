@@ -4,22 +4,32 @@
 
 #include "CurveTerrain.h"
 #include "Landmarks.h"
+#include "Generator.h"
+#include "NavGraph.h"
+#include "SpatialGrid.h"
+#include "Arena.h"
+#include "PathCost.h"
 
 #include <vector>
+#include <queue>
 
 class Paths : public Stage
 {
 public:
-	Paths(CurveTerrain &terrain, Landmarks &landmarks, int debugNum = 0);
+	Paths(Generator &generator, CurveTerrain &terrain, Landmarks &landmarks, int debugNum = 0);
 	~Paths();
 
 	virtual void Setup();
+	virtual bool Generate();
 	virtual bool Render();
 	virtual void Draw();
+	virtual void DrawLevel(float scale);
 	virtual void Reset();
 	virtual void DebugNum(int key);
 	virtual void DebugClick(int x, int y);
 	virtual char* GetMessage();
+	virtual bool WriteSnapshot(SnapshotWriter& out);
+	virtual bool ReadSnapshot(SnapshotReader& in);
 
 	struct pathBit
 	{
@@ -33,18 +43,49 @@ public:
 		}
 	};
 
+	// search state lives in the stage's arena and goes away all at once in Reset
+	typedef std::map<int, pathBit, std::less<int>, ArenaAllocator<std::pair<const int, pathBit>>> visitedMap;
+	typedef std::list<int, ArenaAllocator<int>> openList;
+
+	// One direction of the bidirectional search, over lattice node indices.
+	struct searchSide
+	{
+		ArenaVector<float> spend;
+		ArenaVector<int> parent;
+		ArenaVector<bool> closed;
+		std::priority_queue<std::pair<float, int>, vector<std::pair<float, int>>, std::greater<std::pair<float, int>>> open;
+		int closest; // node nearest the far end, for when we give up early
+		float closestDist;
+	};
+
 	struct progress
 	{
 		int currentIndex = -1;
 		ofPoint currentPos;
-		std::map<int, pathBit> visited;
-		std::list<int> open;
+		visitedMap visited;
+		openList open;
 
 		int iteration;
 		bool found;
 
 		int length;
 		bool traced;
+
+		// bidirectional planner only. The lattice is every pathSegDist from the start, across the window.
+		bool bidirectional = false;
+		ofPoint latticeOrigin;
+		int latticeWidth;
+		int latticeHeight;
+		int startNode;
+		int goalNode;
+		ArenaVector<float> penalty;
+		searchSide forward;
+		searchSide backward;
+		int meetNode;
+		float meetCost;
+
+		// clusters of the nav graph this path may search, empty for anywhere
+		vector<bool> corridor;
 	};
 
 	enum PathStyle {
@@ -58,10 +99,18 @@ public:
 		ofPoint end;
 		PathStyle style;
 		progress progress;
+		// the route field is at the start, so the route is walked from the end
+		bool traceFromEnd;
 	};
 
 	void GetCosts(ofPoint pos, float& valCost, float& distCost, float& totalCost, float& shoreCost);
-	void DrawRoute(ofPolyline stroke, PathStyle style, bool testOverlap);
+	// times the neighbour cost kernels on this map's terrain
+	void BenchmarkExpansion();
+	// leaves out the dots too close to anything already in overlapGrid, if there is one
+	void DrawRoute(const ofPolyline& stroke, PathStyle style, SpatialGrid* overlapGrid);
+
+	const vector<ofPolyline>& GetDrawnPaths() { return drawnPaths; }
+	PathStyle GetPathStyle(int idx) { return paths[idx].style; }
 
 private:
 	int debugNum;
@@ -80,23 +129,66 @@ private:
 	};
 
 	vector<ofPolyline> drawnPaths;
+	// segments of drawnPaths, so DrawRoute only checks routes near each dot
+	SpatialGrid routeGrid;
+	// scratch for TracePath, kept so tracing a route doesn't allocate
+	vector<ofPoint> controlPoints;
+	vector<double> smoothingSums;
 
+	void PickPaths();
 	void SetupPath(Path& path);
 	void FindPath(Path& path);
+	void BuildStroke(Path& path);
 	void TracePath(Path& path);
 
+	void SetupBidirectional(Path& path);
+	void StepBidirectional(Path& path);
+	bool ExpandSide(Path& path, searchSide& side, searchSide& other, ofPoint target);
+	void FinishBidirectional(Path& path);
+	ofPoint NodePos(progress& state, int node);
+	float StepPenalty(Path& path, int node);
+
 	bool DoRender();
 	void DebugRender();
 	void RenderCosts();
 	float Cost(ofPoint start, ofPoint next, ofPoint target, float& valCost, float& distCost, float& totalCost, float& shoreCost);
-	float Cost(ofPoint start, ofPoint next, ofPoint target);
-
+	// the corner anchored lattice shared by the nav graph and the route fields
+	void BuildLattice();
+	int LatticeNode(ofPoint pos);
+	// cost to go to goal from every lattice node, built the first time a route needs it
+	const vector<float>& GetRouteField(int goal);
+	void FollowRouteField(Path& path);
+
+	Generator &generator;
+	Random rng;
 	Landmarks &landmarks;
 	CurveTerrain &terrain;
 
+	// declared before paths, so it outlives everything allocated from it
+	Arena arena;
+
 	int pathIdx = -1;
+	// true when Generate did the searching, so Render only has to draw
+	bool generated = false;
 	vector<Path> paths;
 	ofPoint offsets[8];
+	// offsets * pathSegDist, laid out for ExpandNeighbours
+	float stepX[8];
+	float stepY[8];
+	// one byte per visited key of the path being searched, so FindPath doesn't have to look them up
+	vector<unsigned char> seen;
+	NavGraph navGraph;
+
+	int latticeWidth = 0;
+	int latticeHeight = 0;
+	vector<float> latticeLand;
+	// the shore part of the step cost at each node, already scaled for a penalty
+	vector<float> latticeShore;
+	struct RouteField {
+		int goal;
+		vector<float> cost;
+	};
+	vector<RouteField> routeFields;
 
 	ofFbo image;
 	ofFbo debugImage;
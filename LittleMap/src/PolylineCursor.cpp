@@ -0,0 +1,43 @@
+#include "PolylineCursor.h"
+
+PolylineCursor::PolylineCursor(const ofPolyline& line)
+	: line(line)
+	, segment(0)
+	, length(0)
+{
+	cumulative.reserve(line.size());
+	float total = 0;
+	for (int i = 0; i < line.size(); i++)
+	{
+		if (i > 0)
+			total += line[i].distance(line[i - 1]);
+		cumulative.push_back(total);
+	}
+}
+
+bool PolylineCursor::Done() const
+{
+	return line.size() < 2 || length >= cumulative.back();
+}
+
+ofPoint PolylineCursor::GetPoint() const
+{
+	if (line.size() < 2)
+		return line.size() == 1 ? line[0] : ofPoint();
+	if (Done())
+		return line[line.size() - 1];
+
+	float segmentLength = cumulative[segment + 1] - cumulative[segment];
+	float t = segmentLength > 0 ? (length - cumulative[segment]) / segmentLength : 0;
+	return line[segment] + (line[segment + 1] - line[segment]) * t;
+}
+
+void PolylineCursor::Advance(float distance)
+{
+	length += distance;
+	// stop on the first segment that reaches length, like ofPolyline's own search
+	while (segment < (int)cumulative.size() - 2 && cumulative[segment + 1] < length)
+	{
+		segment++;
+	}
+}
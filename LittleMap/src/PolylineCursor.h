@@ -0,0 +1,27 @@
+#pragma once
+#include "ofMain.h"
+
+#include <vector>
+
+// Walks forward along an open polyline by distance. The cumulative lengths are worked out once,
+// and Advance only steps over the segments it passes, so stippling a stroke is a single pass
+// instead of a getIndexAtLength/getPointAtLength search per dot.
+class PolylineCursor
+{
+public:
+	PolylineCursor(const ofPolyline& line);
+
+	// true once we've reached the last point, same as getIndexAtLength(len) >= size() - 1
+	bool Done() const;
+	ofPoint GetPoint() const;
+	float GetLength() const { return length; }
+	float GetTotalLength() const { return cumulative.empty() ? 0 : cumulative.back(); }
+
+	void Advance(float distance);
+
+private:
+	const ofPolyline& line;
+	vector<float> cumulative;
+	int segment;
+	float length;
+};
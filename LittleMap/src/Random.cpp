@@ -0,0 +1,31 @@
+#include "Random.h"
+
+static uint64_t SplitMix64(uint64_t& state)
+{
+	uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+	return z ^ (z >> 31);
+}
+
+Random::Random()
+{
+	Seed(0);
+}
+
+Random::Random(uint64_t seed)
+{
+	Seed(seed);
+}
+
+void Random::Seed(uint64_t seed)
+{
+	// splitmix spreads any seed, even 0, into a state that isn't all zeros
+	uint64_t state = seed;
+	uint64_t a = SplitMix64(state);
+	uint64_t b = SplitMix64(state);
+	s[0] = (uint32_t)a;
+	s[1] = (uint32_t)(a >> 32);
+	s[2] = (uint32_t)b;
+	s[3] = (uint32_t)(b >> 32);
+}
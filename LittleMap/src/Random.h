@@ -0,0 +1,81 @@
+#pragma once
+#include "ofMain.h"
+
+#include <stdint.h>
+
+// xoshiro128** - small, fast, and one per user, unlike ofRandom's single global stream.
+class Random
+{
+public:
+	Random();
+	Random(uint64_t seed);
+
+	void Seed(uint64_t seed);
+
+	uint32_t Next()
+	{
+		uint32_t result = Rotl(s[1] * 5, 7) * 9;
+		uint32_t t = s[1] << 9;
+		s[2] ^= s[0];
+		s[3] ^= s[1];
+		s[1] ^= s[2];
+		s[0] ^= s[3];
+		s[2] ^= t;
+		s[3] = Rotl(s[3], 11);
+		return result;
+	}
+
+	// [0, 1)
+	float Float() { return (Next() >> 8) * (1.0f / 16777216.0f); }
+	// [0, max)
+	float Range(float max) { return Float() * max; }
+	// [min, max)
+	float Range(float min, float max) { return min + Float() * (max - min); }
+	// [0, n)
+	int Int(int n) { return (int)(((uint64_t)Next() * (uint32_t)n) >> 32); }
+
+	template<class T>
+	void Shuffle(vector<T>& values)
+	{
+		for (int i = (int)values.size() - 1; i > 0; i--)
+		{
+			std::swap(values[i], values[Int(i + 1)]);
+		}
+	}
+
+private:
+	static uint32_t Rotl(uint32_t x, int k) { return (x << k) | (x >> (32 - k)); }
+
+	uint32_t s[4];
+};
+
+// Counter based: draw n of a stream is a pure function of (seed, key, n), with no state carried
+// from one draw to the next. Streams for different keys can be drawn on any thread, in any
+// order, and always come out the same.
+class CounterRandom
+{
+public:
+	CounterRandom(uint64_t seed, uint64_t key)
+		: base(seed ^ (key * 0xD1B54A32D192ED03ull))
+		, counter(0)
+	{
+	}
+
+	uint32_t Next()
+	{
+		// splitmix's finalizer over the counter
+		uint64_t z = base + (++counter) * 0x9E3779B97F4A7C15ull;
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+		return (uint32_t)((z ^ (z >> 31)) >> 32);
+	}
+
+	// [0, 1)
+	float Float() { return (Next() >> 8) * (1.0f / 16777216.0f); }
+	// [0, n)
+	int Int(int n) { return (int)(((uint64_t)Next() * (uint32_t)n) >> 32); }
+
+private:
+	uint64_t base;
+	uint64_t counter;
+};
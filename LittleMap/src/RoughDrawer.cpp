@@ -1,15 +1,16 @@
 #include "RoughDrawer.h"
+#include "PolylineCursor.h"
 #include "ofMain.h"
 
-void RoughTracePath(ofPolyline& path, float minSize, float maxSize)
+void RoughTracePath(ofPolyline& path, float minSize, float maxSize, Random& rng)
 {
-	float len = 0;
-	while (path.getIndexAtLength(len) < path.size()-1) // apparently size - 1....
+	PolylineCursor cursor(path);
+	while (!cursor.Done())
 	{
-		ofPoint pt = path.getPointAtLength(len);
+		ofPoint pt = cursor.GetPoint();
 		
-		ofDrawCircle(pt, ofRandom(minSize, maxSize));
+		ofDrawCircle(pt, rng.Range(minSize, maxSize));
 
-		len += 1;
+		cursor.Advance(1);
 	}
 }
\ No newline at end of file
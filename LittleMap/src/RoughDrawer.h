@@ -1,4 +1,6 @@
 #pragma once
 #include "ofMain.h"
 
-void RoughTracePath(ofPolyline& path, float minSize, float maxSize);
+#include "Random.h"
+
+void RoughTracePath(ofPolyline& path, float minSize, float maxSize, Random& rng);
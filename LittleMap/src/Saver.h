@@ -11,6 +11,8 @@ public:
 	virtual void Setup();
 	virtual bool Render();
 	virtual void Draw();
+	// nothing to draw, and Draw would save a screenshot
+	virtual void DrawLevel(float scale) {};
 
 	void Save(bool force);
 
@@ -0,0 +1,167 @@
+#include "ScanlineFill.h"
+
+// sample rows per pixel row
+const int subScanlines = 4;
+
+ScanlineFill::ScanlineFill()
+	: width(0)
+	, height(0)
+{
+}
+
+ScanlineFill::~ScanlineFill()
+{
+}
+
+void ScanlineFill::Setup(int width, int height)
+{
+	this->width = width;
+	this->height = height;
+	pixels.allocate(width, height, 4);
+	coverage.assign(width + 1, 0);
+	delta.assign(width + 2, 0);
+}
+
+void ScanlineFill::Clear(const ofColor& color)
+{
+	unsigned char* data = pixels.getData();
+	for (int i = 0; i < width * height; i++)
+	{
+		data[i * 4 + 0] = color.r;
+		data[i * 4 + 1] = color.g;
+		data[i * 4 + 2] = color.b;
+		data[i * 4 + 3] = color.a;
+	}
+}
+
+void ScanlineFill::BuildEdges(const ofPolyline& outline)
+{
+	edges.clear();
+	int n = outline.size();
+	for (int i = 0; i < n; i++)
+	{
+		ofPoint a = outline[i];
+		ofPoint b = outline[(i + 1) % n];
+		if (a.y == b.y)
+			continue; // horizontal edges never cross a sample row
+		if (a.y > b.y)
+			std::swap(a, b);
+		edges.push_back(Edge{ a.y, b.y, a.x, (b.x - a.x) / (b.y - a.y) });
+	}
+
+	std::sort(edges.begin(), edges.end(), [](const Edge& l, const Edge& r) { return l.yTop < r.yTop; });
+}
+
+void ScanlineFill::Fill(const ofPolyline& outline, const ofColor& color)
+{
+	if (outline.size() < 3 || width == 0)
+		return;
+
+	BuildEdges(outline);
+	if (edges.empty())
+		return;
+
+	float yMin = edges.front().yTop;
+	float yMax = yMin;
+	for (auto& edge : edges)
+	{
+		yMax = std::max(yMax, edge.yBottom);
+	}
+
+	int rowStart = std::max(0, (int)std::floor(yMin));
+	int rowEnd = std::min(height - 1, (int)std::ceil(yMax));
+
+	active.clear();
+	int nextEdge = 0;
+	const float sampleWeight = 1.0f / subScanlines;
+
+	for (int row = rowStart; row <= rowEnd; row++)
+	{
+		int spanMin = width;
+		int spanMax = -1;
+
+		for (int s = 0; s < subScanlines; s++)
+		{
+			float y = row + (s + 0.5f) * sampleWeight;
+
+			// edges are sorted by top, so the active list only ever takes from the front of the table
+			while (nextEdge < edges.size() && edges[nextEdge].yTop <= y)
+			{
+				active.push_back(nextEdge);
+				nextEdge++;
+			}
+
+			crossings.clear();
+			for (int i = 0; i < active.size();)
+			{
+				const Edge& edge = edges[active[i]];
+				if (edge.yBottom <= y)
+				{
+					active[i] = active.back();
+					active.pop_back();
+					continue;
+				}
+				if (edge.yTop <= y)
+					crossings.push_back(edge.xTop + (y - edge.yTop) * edge.dxdy);
+				i++;
+			}
+			std::sort(crossings.begin(), crossings.end());
+
+			// even-odd: inside between each pair of crossings
+			for (int i = 0; i + 1 < crossings.size(); i += 2)
+			{
+				float a = ofClamp(crossings[i], 0.0f, (float)width);
+				float b = ofClamp(crossings[i + 1], 0.0f, (float)width);
+				if (b <= a)
+					continue;
+
+				int ia = (int)a;
+				int ib = (int)b;
+				if (ia == ib)
+				{
+					coverage[ia] += (b - a) * sampleWeight;
+				}
+				else
+				{
+					coverage[ia] += (ia + 1 - a) * sampleWeight;
+					delta[ia + 1] += sampleWeight;
+					delta[ib] -= sampleWeight;
+					coverage[ib] += (b - ib) * sampleWeight;
+				}
+				spanMin = std::min(spanMin, ia);
+				spanMax = std::max(spanMax, ib);
+			}
+		}
+
+		if (spanMax >= 0)
+		{
+			BlendRow(row, spanMin, std::min(spanMax, width - 1), color);
+
+			// leave the scratch clean for the next row
+			for (int x = spanMin; x <= spanMax + 1 && x <= width; x++)
+			{
+				coverage[x] = 0;
+				delta[x] = 0;
+			}
+		}
+	}
+}
+
+void ScanlineFill::BlendRow(int y, int x0, int x1, const ofColor& color)
+{
+	unsigned char* data = pixels.getData() + (y * width) * 4;
+	float run = 0;
+	for (int x = x0; x <= x1; x++)
+	{
+		run += delta[x];
+		float alpha = ofClamp(run + coverage[x], 0.0f, 1.0f) * (color.a / 255.0f);
+		if (alpha <= 0)
+			continue;
+
+		unsigned char* px = data + x * 4;
+		px[0] = (unsigned char)(px[0] + (color.r - px[0]) * alpha + 0.5f);
+		px[1] = (unsigned char)(px[1] + (color.g - px[1]) * alpha + 0.5f);
+		px[2] = (unsigned char)(px[2] + (color.b - px[2]) * alpha + 0.5f);
+		px[3] = (unsigned char)(px[3] + (255 - px[3]) * alpha + 0.5f);
+	}
+}
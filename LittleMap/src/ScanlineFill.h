@@ -0,0 +1,44 @@
+#pragma once
+#include "ofMain.h"
+
+#include <vector>
+
+// CPU polygon fill for the island interiors. Each polygon goes through an edge table and is
+// filled even-odd, like OF_POLY_WINDING_ODD, with anti-aliasing from coverage: exact along each
+// scanline and supersampled between them. No GL needed, the result is just pixels.
+class ScanlineFill
+{
+public:
+	ScanlineFill();
+	~ScanlineFill();
+
+	void Setup(int width, int height);
+	void Clear(const ofColor& color);
+
+	// the outline is treated as closed; the fill is blended over what's already there
+	void Fill(const ofPolyline& outline, const ofColor& color);
+
+	ofPixels& GetPixels() { return pixels; }
+
+private:
+	struct Edge {
+		float yTop;
+		float yBottom;
+		float xTop;
+		float dxdy;
+	};
+
+	void BuildEdges(const ofPolyline& outline);
+	void BlendRow(int y, int x0, int x1, const ofColor& color);
+
+	int width;
+	int height;
+	ofPixels pixels;
+
+	// scratch, kept between fills
+	vector<Edge> edges;
+	vector<int> active;
+	vector<float> crossings;
+	vector<float> coverage;
+	vector<float> delta;
+};
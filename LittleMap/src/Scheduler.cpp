@@ -0,0 +1,164 @@
+#include "Scheduler.h"
+
+Scheduler::Scheduler()
+	: generating(0)
+	, quit(false)
+	, cancel(false)
+{
+}
+
+Scheduler::~Scheduler()
+{
+	Stop();
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		quit = true;
+	}
+	wake.notify_all();
+	for (auto& thread : threads)
+	{
+		thread.join();
+	}
+}
+
+void Scheduler::Setup(Stage** stageList, int count, int threadCount)
+{
+	stages.assign(stageList, stageList + count);
+	states.assign(count, Waiting);
+	started.assign(count, false);
+
+	// inputs by index, so a stage can find out whether they're done
+	inputs.assign(count, vector<int>());
+	for (int i = 0; i < count; i++)
+	{
+		if (stages[i] == nullptr)
+			continue;
+		for (Stage* input : stages[i]->GetInputs())
+		{
+			auto found = std::find(stages.begin(), stages.end(), input);
+			if (found != stages.end())
+				inputs[i].push_back(found - stages.begin());
+		}
+	}
+
+	for (int i = 0; i < threadCount; i++)
+	{
+		threads.push_back(std::thread(&Scheduler::WorkerLoop, this));
+	}
+}
+
+bool Scheduler::IsReady(int idx)
+{
+	for (int input : inputs[idx])
+	{
+		if (states[input] != Complete)
+			return false;
+	}
+	return true;
+}
+
+void Scheduler::Update(int limit)
+{
+	for (int i = 0; i < stages.size() && i <= limit; i++)
+	{
+		bool render = false;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (stages[i] == nullptr)
+			{
+				states[i] = Complete;
+				continue;
+			}
+			if (states[i] == Waiting && IsReady(i))
+			{
+				states[i] = Queued;
+				started[i] = true;
+				queue.push_back(i);
+				wake.notify_one();
+			}
+			// a stage read from a snapshot can get here before its inputs are drawn
+			render = states[i] == Generated && IsReady(i);
+		}
+
+		// in step order, outside the lock since Render can take a while
+		if (render && stages[i]->Render())
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			states[i] = Complete;
+		}
+	}
+}
+
+void Scheduler::WorkerLoop()
+{
+	while (true)
+	{
+		int idx;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [this]() { return quit || (!queue.empty() && !cancel); });
+			if (quit)
+				return;
+			idx = queue.front();
+			queue.pop_front();
+			states[idx] = Generating;
+			generating++;
+		}
+
+		bool done = false;
+		while (!cancel && !done)
+		{
+			done = stages[idx]->Generate();
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			states[idx] = done ? Generated : Waiting;
+			generating--;
+		}
+		idle.notify_all();
+	}
+}
+
+void Scheduler::Stop()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	cancel = true;
+	idle.wait(lock, [this]() { return generating == 0; });
+
+	for (int idx : queue)
+	{
+		states[idx] = Waiting;
+	}
+	queue.clear();
+	cancel = false;
+}
+
+void Scheduler::Restart(int first)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	for (int i = first; i < states.size(); i++)
+	{
+		states[i] = Waiting;
+		started[i] = false;
+	}
+}
+
+void Scheduler::SetGenerated(int idx)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	states[idx] = Generated;
+	started[idx] = true;
+}
+
+bool Scheduler::IsComplete(int idx)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return states[idx] == Complete;
+}
+
+bool Scheduler::WasStarted(int idx)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return started[idx];
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include "ofMain.h"
+#include "Stage.h"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <atomic>
+
+// Runs each stage as soon as the stages it depends on are finished, rather than strictly in
+// order. Generate goes to a small pool of worker threads; Render draws, so it's called from
+// Update on the GL thread. Stages are still drawn in ofApp's drawOrder, so what ends up on
+// screen doesn't depend on which one finished first.
+class Scheduler
+{
+public:
+	Scheduler();
+	~Scheduler();
+
+	void Setup(Stage** stages, int count, int threads);
+
+	// Starts whatever is ready, up to and including stage limit, and renders anything that's
+	// done generating.
+	void Update(int limit);
+
+	// Waits for every running Generate to stop. Stages that weren't finished go back to
+	// waiting, and carry on from where they were when they're started again.
+	void Stop();
+	// Stages from first on are waiting again; reset them before the next Update.
+	void Restart(int first);
+	// for a stage read back from a snapshot, which only needs rendering
+	void SetGenerated(int idx);
+
+	bool IsComplete(int idx);
+	// queued, generated or rendered since the last Restart, and so needs a Reset
+	bool WasStarted(int idx);
+
+private:
+	enum State {
+		Waiting,
+		Queued,
+		Generating,
+		Generated,
+		Complete,
+	};
+
+	bool IsReady(int idx);
+	void WorkerLoop();
+
+	vector<Stage*> stages;
+	vector<vector<int>> inputs;
+	vector<State> states;
+	vector<bool> started;
+
+	vector<std::thread> threads;
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable idle;
+	std::deque<int> queue;
+	int generating;
+	bool quit;
+	std::atomic<bool> cancel;
+};
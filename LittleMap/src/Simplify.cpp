@@ -0,0 +1,100 @@
+#include "Simplify.h"
+
+static float SegmentDistanceSquared(const ofPoint& pt, const ofPoint& a, const ofPoint& b)
+{
+	ofPoint ab = b - a;
+	float lengthSquared = ab.x * ab.x + ab.y * ab.y;
+	float t = lengthSquared > 0 ? ((pt.x - a.x) * ab.x + (pt.y - a.y) * ab.y) / lengthSquared : 0;
+	t = std::min(1.0f, std::max(0.0f, t));
+	float dx = a.x + ab.x * t - pt.x;
+	float dy = a.y + ab.y * t - pt.y;
+	return dx * dx + dy * dy;
+}
+
+void SimplifyDouglasPeucker(const vector<ofPoint>& in, float tolerance, vector<ofPoint>& out)
+{
+	out.clear();
+	if (in.size() < 3)
+	{
+		out = in;
+		return;
+	}
+
+	// with a stack rather than recursion, since a coastline can run to thousands of points
+	vector<bool> keep(in.size(), false);
+	keep.front() = true;
+	keep.back() = true;
+	vector<std::pair<int, int>> spans;
+	spans.push_back(std::make_pair(0, (int)in.size() - 1));
+	float toleranceSquared = tolerance * tolerance;
+	while (!spans.empty())
+	{
+		std::pair<int, int> span = spans.back();
+		spans.pop_back();
+
+		int furthest = -1;
+		float furthestDistance = toleranceSquared;
+		for (int i = span.first + 1; i < span.second; i++)
+		{
+			float distance = SegmentDistanceSquared(in[i], in[span.first], in[span.second]);
+			if (distance > furthestDistance)
+			{
+				furthestDistance = distance;
+				furthest = i;
+			}
+		}
+
+		if (furthest != -1)
+		{
+			keep[furthest] = true;
+			spans.push_back(std::make_pair(span.first, furthest));
+			spans.push_back(std::make_pair(furthest, span.second));
+		}
+	}
+
+	for (int i = 0; i < in.size(); i++)
+	{
+		if (keep[i])
+			out.push_back(in[i]);
+	}
+}
+
+// deep enough for any span a map has, and stops a degenerate one going on forever
+const int maxBezierDepth = 12;
+
+// Halves the curve until its middle control points are within tolerance of the chord, which
+// puts the whole curve within tolerance of it. The end is added, the start is left to the caller.
+static void FlattenBezier(const ofPoint& a, const ofPoint& b, const ofPoint& c, const ofPoint& d, float toleranceSquared, int depth, vector<ofPoint>& out)
+{
+	if (depth >= maxBezierDepth || (SegmentDistanceSquared(b, a, d) <= toleranceSquared && SegmentDistanceSquared(c, a, d) <= toleranceSquared))
+	{
+		out.push_back(d);
+		return;
+	}
+
+	ofPoint ab = (a + b) * 0.5f;
+	ofPoint bc = (b + c) * 0.5f;
+	ofPoint cd = (c + d) * 0.5f;
+	ofPoint abc = (ab + bc) * 0.5f;
+	ofPoint bcd = (bc + cd) * 0.5f;
+	ofPoint middle = (abc + bcd) * 0.5f;
+	FlattenBezier(a, ab, abc, middle, toleranceSquared, depth + 1, out);
+	FlattenBezier(middle, bcd, cd, d, toleranceSquared, depth + 1, out);
+}
+
+void FlattenCatmullRom(const vector<ofPoint>& points, float tolerance, vector<ofPoint>& out)
+{
+	if (points.size() < 4)
+		return;
+
+	float toleranceSquared = tolerance * tolerance;
+	out.push_back(points[1]);
+	for (int i = 1; i + 2 < points.size(); i++)
+	{
+		const ofPoint& p0 = points[i - 1];
+		const ofPoint& p1 = points[i];
+		const ofPoint& p2 = points[i + 1];
+		const ofPoint& p3 = points[i + 2];
+		FlattenBezier(p1, p1 + (p2 - p0) / 6, p2 - (p3 - p1) / 6, p2, toleranceSquared, 0, out);
+	}
+}
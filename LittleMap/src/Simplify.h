@@ -0,0 +1,14 @@
+#pragma once
+#include "ofMain.h"
+
+#include <vector>
+
+// Douglas-Peucker: drops every point it can while keeping the line within tolerance of the
+// original. The two ends are always kept.
+void SimplifyDouglasPeucker(const vector<ofPoint>& in, float tolerance, vector<ofPoint>& out);
+
+// The curve ofPolyline::curveTo draws through points, a Catmull-Rom spline whose first and last
+// points only steer the ends. Each span is the cubic Bezier it's equal to, cut into lines until
+// they're within tolerance of it, so gentle spans come out as a few points rather than curveTo's
+// twenty. Appends to out.
+void FlattenCatmullRom(const vector<ofPoint>& points, float tolerance, vector<ofPoint>& out);
@@ -0,0 +1,142 @@
+#include "Snapshot.h"
+
+#include <cstdio>
+
+const char snapshotMagic[4] = { 'L', 'M', 'A', 'P' };
+const int snapshotVersion = 1;
+
+struct SnapshotHeader
+{
+	char magic[4];
+	int version;
+	int step;
+	int seed;
+	int width;
+	int height;
+};
+
+void SnapshotWriter::WriteString(const std::string& str)
+{
+	WriteArray(str.data(), (int)str.size());
+}
+
+void SnapshotWriter::WritePolyline(const ofPolyline& line)
+{
+	const vector<ofPoint>& points = line.getVertices();
+	WriteArray(points.data(), (int)points.size());
+	Write(line.isClosed());
+}
+
+bool SnapshotWriter::Save(const std::string& path, int step, int seed)
+{
+	SnapshotHeader header;
+	memcpy(header.magic, snapshotMagic, sizeof(header.magic));
+	header.version = snapshotVersion;
+	header.step = step;
+	header.seed = seed;
+	header.width = ofGetWidth();
+	header.height = ofGetHeight();
+
+	FILE* file = fopen(ofToDataPath(path).c_str(), "wb");
+	if (file == nullptr)
+	{
+		printf("Couldn't write snapshot %s\n", path.c_str());
+		return false;
+	}
+	bool written = fwrite(&header, sizeof(header), 1, file) == 1
+		&& (data.empty() || fwrite(data.data(), data.size(), 1, file) == 1);
+	fclose(file);
+	return written;
+}
+
+SnapshotReader::SnapshotReader()
+	: cursor(nullptr)
+	, end(nullptr)
+	, seed(0)
+	, failed(true)
+{
+}
+
+bool SnapshotReader::Open(const std::string& path, int step)
+{
+	failed = true;
+	if (!file.Open(ofToDataPath(path)) || file.GetSize() < sizeof(SnapshotHeader))
+		return false;
+
+	const char* data = file.GetData();
+	if (data == nullptr)
+	{
+		file.Close();
+		return false;
+	}
+
+	SnapshotHeader header;
+	memcpy(&header, data, sizeof(header));
+	if (memcmp(header.magic, snapshotMagic, sizeof(header.magic)) != 0 || header.version != snapshotVersion
+		|| header.step != step || header.width != ofGetWidth() || header.height != ofGetHeight())
+	{
+		file.Close();
+		return false;
+	}
+
+	seed = header.seed;
+	cursor = data + sizeof(header);
+	end = data + file.GetSize();
+	failed = false;
+	return true;
+}
+
+bool SnapshotReader::Has(size_t bytes)
+{
+	if (failed || (size_t)(end - cursor) < bytes)
+		return Fail();
+	return true;
+}
+
+bool SnapshotReader::Fail()
+{
+	failed = true;
+	return false;
+}
+
+bool SnapshotReader::Read(bool& value)
+{
+	unsigned char byte;
+	if (!Read(byte) || byte > 1)
+		return Fail();
+	value = byte == 1;
+	return true;
+}
+
+bool SnapshotReader::ReadCount(int& count, size_t minBytesPerItem)
+{
+	if (!Read(count) || count < 0)
+		return Fail();
+	if (minBytesPerItem > 0 && (size_t)count > (size_t)(end - cursor) / minBytesPerItem)
+		return Fail();
+	return true;
+}
+
+bool SnapshotReader::ReadString(std::string& str)
+{
+	int count;
+	if (!ReadCount(count, 1))
+		return false;
+	str.assign(cursor, count);
+	cursor += count;
+	return true;
+}
+
+bool SnapshotReader::ReadPolyline(ofPolyline& line)
+{
+	vector<ofPoint> points;
+	bool closed;
+	if (!ReadArray(points) || !Read(closed))
+		return false;
+
+	line.clear();
+	line.addVertices(points);
+	if (closed)
+		line.close();
+	return true;
+}
@@ -0,0 +1,117 @@
+#pragma once
+#include "ofMain.h"
+
+#include "MappedFile.h"
+
+#include <type_traits>
+#include <cstring>
+
+// A stage's output as a flat binary file, one per step, so a map can be picked up again from
+// any step without generating the ones before it. Every file starts with a header naming the
+// step, the seed and the window size it was made for; the rest is up to the stage.
+// Values are written as raw bytes, so a snapshot only reads back on the same kind of machine.
+
+class SnapshotWriter
+{
+public:
+	template<class T>
+	void Write(const T& value)
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "snapshots only hold plain data");
+		const char* bytes = (const char*)&value;
+		data.insert(data.end(), bytes, bytes + sizeof(T));
+	}
+
+	// count first, then the values
+	template<class T>
+	void WriteArray(const T* values, int count)
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "snapshots only hold plain data");
+		Write(count);
+		const char* bytes = (const char*)values;
+		data.insert(data.end(), bytes, bytes + sizeof(T) * count);
+	}
+	void WriteString(const std::string& str);
+	void WritePolyline(const ofPolyline& line);
+
+	bool Save(const std::string& path, int step, int seed);
+	void Clear() { data.clear(); }
+
+private:
+	vector<char> data;
+};
+
+class SnapshotReader
+{
+public:
+	SnapshotReader();
+
+	// Fails if the file is missing or was made for another step or window size.
+	bool Open(const std::string& path, int step);
+	int GetSeed() const { return seed; }
+
+	// All of these fail, and keep failing, once anything runs past the end of the file.
+	template<class T>
+	bool Read(T& value)
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "snapshots only hold plain data");
+		if (!Has(sizeof(T)))
+			return false;
+		memcpy(&value, cursor, sizeof(T));
+		cursor += sizeof(T);
+		return true;
+	}
+	// a byte that has to be 0 or 1, since any other bool would be undefined
+	bool Read(bool& value);
+
+	// A count of things still to be read, each at least minBytesPerItem long. Fails if it's
+	// negative or more than the rest of the file could hold, so it's safe to size things by.
+	bool ReadCount(int& count, size_t minBytesPerItem);
+	// the least a WriteString or WritePolyline can take up, for ReadCount
+	static const size_t minStringBytes = sizeof(int);
+	static const size_t minPolylineBytes = sizeof(int) + sizeof(bool);
+
+	// reads exactly count values, as written by WriteArray
+	template<class T>
+	bool ReadArray(T* values, int count)
+	{
+		int written;
+		if (!Read(written) || written != count || !Has(sizeof(T) * (size_t)count))
+			return Fail();
+		Copy(values, count);
+		return true;
+	}
+	// as many values as were written
+	template<class T>
+	bool ReadArray(vector<T>& values)
+	{
+		int count;
+		if (!ReadCount(count, sizeof(T)))
+			return false;
+		values.resize(count);
+		Copy(values.data(), count);
+		return true;
+	}
+	bool ReadString(std::string& str);
+	bool ReadPolyline(ofPolyline& line);
+
+	// true if the stage read back everything it wrote
+	bool IsDone() const { return !failed && cursor == end; }
+
+private:
+	bool Has(size_t bytes);
+	bool Fail();
+	template<class T>
+	void Copy(T* values, int count)
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "snapshots only hold plain data");
+		memcpy(values, cursor, sizeof(T) * count);
+		cursor += sizeof(T) * count;
+	}
+
+	MappedFile file;
+	const char* cursor;
+	const char* end;
+	int seed;
+	bool failed;
+};
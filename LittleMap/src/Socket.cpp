@@ -0,0 +1,183 @@
+#include "Socket.h"
+
+#include <mutex>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+const SocketHandle noSocket = (SocketHandle)INVALID_SOCKET;
+static void CloseSocket(SocketHandle handle) { closesocket(handle); }
+#else
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+const SocketHandle noSocket = -1;
+static void CloseSocket(SocketHandle handle) { close(handle); }
+#endif
+
+// a viewer that hangs up early shouldn't take the app down with SIGPIPE
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+static void StartNetworking()
+{
+#ifdef _WIN32
+	static std::once_flag started;
+	std::call_once(started, []() {
+		WSADATA data;
+		WSAStartup(MAKEWORD(2, 2), &data);
+	});
+#endif
+}
+
+static sockaddr_in Loopback(int port)
+{
+	sockaddr_in address;
+	memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_port = htons((unsigned short)port);
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	return address;
+}
+
+Socket::Socket()
+	: handle(noSocket)
+{
+}
+
+Socket::Socket(SocketHandle handle)
+	: handle(handle)
+{
+}
+
+Socket::~Socket()
+{
+	Close();
+}
+
+Socket::Socket(Socket&& other)
+	: handle(other.handle)
+{
+	other.handle = noSocket;
+}
+
+Socket& Socket::operator=(Socket&& other)
+{
+	if (this != &other)
+	{
+		Close();
+		handle = other.handle;
+		other.handle = noSocket;
+	}
+	return *this;
+}
+
+bool Socket::Listen(int port, int backlog)
+{
+	StartNetworking();
+	Close();
+
+	handle = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	if (handle == noSocket)
+		return false;
+
+	int reuse = 1;
+	setsockopt(handle, SOL_SOCKET, SO_REUSEADDR, (const char*)&reuse, sizeof(reuse));
+
+	sockaddr_in address = Loopback(port);
+	if (bind(handle, (sockaddr*)&address, sizeof(address)) != 0 || listen(handle, backlog) != 0)
+	{
+		Close();
+		return false;
+	}
+	return true;
+}
+
+Socket Socket::Accept()
+{
+	SocketHandle client = accept(handle, nullptr, nullptr);
+	return Socket(client);
+}
+
+bool Socket::Connect(int port)
+{
+	StartNetworking();
+	Close();
+
+	handle = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	if (handle == noSocket)
+		return false;
+
+	// requests are small and answered at once, so don't hold them back
+	int noDelay = 1;
+	setsockopt(handle, IPPROTO_TCP, TCP_NODELAY, (const char*)&noDelay, sizeof(noDelay));
+
+	sockaddr_in address = Loopback(port);
+	if (connect(handle, (sockaddr*)&address, sizeof(address)) != 0)
+	{
+		Close();
+		return false;
+	}
+	return true;
+}
+
+void Socket::Close()
+{
+	if (handle != noSocket)
+		CloseSocket(handle);
+	handle = noSocket;
+}
+
+bool Socket::IsValid() const
+{
+	return handle != noSocket;
+}
+
+bool Socket::WaitReadable(int ms)
+{
+	fd_set readable;
+	FD_ZERO(&readable);
+	FD_SET(handle, &readable);
+	timeval timeout;
+	timeout.tv_sec = ms / 1000;
+	timeout.tv_usec = (ms % 1000) * 1000;
+	return select((int)handle + 1, &readable, nullptr, nullptr, &timeout) > 0;
+}
+
+void Socket::SetTimeout(int ms)
+{
+#ifdef _WIN32
+	DWORD timeout = ms;
+#else
+	timeval timeout;
+	timeout.tv_sec = ms / 1000;
+	timeout.tv_usec = (ms % 1000) * 1000;
+#endif
+	setsockopt(handle, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeout, sizeof(timeout));
+	setsockopt(handle, SOL_SOCKET, SO_SNDTIMEO, (const char*)&timeout, sizeof(timeout));
+}
+
+bool Socket::SendAll(const char* data, size_t size)
+{
+	while (size > 0)
+	{
+		int sent = send(handle, data, (int)std::min(size, (size_t)1 << 30), MSG_NOSIGNAL);
+		if (sent <= 0)
+			return false;
+		data += sent;
+		size -= sent;
+	}
+	return true;
+}
+
+int Socket::Receive(char* data, size_t size)
+{
+	int received = recv(handle, data, (int)size, 0);
+	return received < 0 ? -1 : received;
+}
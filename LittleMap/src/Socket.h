@@ -0,0 +1,43 @@
+#pragma once
+#include "ofMain.h"
+
+#include <stdint.h>
+
+#ifdef _WIN32
+typedef uintptr_t SocketHandle;
+#else
+typedef int SocketHandle;
+#endif
+
+// A blocking TCP socket over winsock or POSIX sockets. Loopback only: it's for serving the
+// map to a viewer on the same machine, not to the network.
+class Socket
+{
+public:
+	Socket();
+	~Socket();
+	Socket(Socket&& other);
+	Socket& operator=(Socket&& other);
+
+	// on 127.0.0.1
+	bool Listen(int port, int backlog);
+	// invalid if nothing's waiting
+	Socket Accept();
+	bool Connect(int port);
+	void Close();
+	bool IsValid() const;
+
+	// true once there's something to read, or a connection to accept
+	bool WaitReadable(int ms);
+	void SetTimeout(int ms);
+	bool SendAll(const char* data, size_t size);
+	// bytes read, 0 once the other end has closed, -1 on an error or timeout
+	int Receive(char* data, size_t size);
+
+private:
+	Socket(const Socket&) = delete;
+	Socket& operator=(const Socket&) = delete;
+	explicit Socket(SocketHandle handle);
+
+	SocketHandle handle;
+};
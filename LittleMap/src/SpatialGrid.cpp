@@ -0,0 +1,202 @@
+#include "SpatialGrid.h"
+
+SpatialGrid::SpatialGrid()
+	: cellSize(1)
+	, gridWidth(0)
+	, gridHeight(0)
+	, queryStamp(0)
+{
+}
+
+SpatialGrid::~SpatialGrid()
+{
+}
+
+void SpatialGrid::Setup(float width, float height, float cellSize)
+{
+	this->cellSize = cellSize;
+	gridWidth = std::max(1, (int)std::ceil(width / cellSize));
+	gridHeight = std::max(1, (int)std::ceil(height / cellSize));
+	cells.resize(gridWidth * gridHeight);
+	Clear();
+}
+
+void SpatialGrid::Clear()
+{
+	for (auto& cell : cells)
+	{
+		cell.clear();
+	}
+	items.clear();
+	queryStamp = 0;
+}
+
+void SpatialGrid::CellRange(const ofRectangle& rect, int& x0, int& y0, int& x1, int& y1)
+{
+	x0 = ofClamp((int)std::floor(rect.getMinX() / cellSize), 0, gridWidth - 1);
+	y0 = ofClamp((int)std::floor(rect.getMinY() / cellSize), 0, gridHeight - 1);
+	x1 = ofClamp((int)std::floor(rect.getMaxX() / cellSize), 0, gridWidth - 1);
+	y1 = ofClamp((int)std::floor(rect.getMaxY() / cellSize), 0, gridHeight - 1);
+}
+
+void SpatialGrid::Insert(const Item& item)
+{
+	int index = items.size();
+	items.push_back(item);
+
+	int x0, y0, x1, y1;
+	CellRange(item.bounds, x0, y0, x1, y1);
+	for (int y = y0; y <= y1; y++)
+	{
+		for (int x = x0; x <= x1; x++)
+		{
+			cells[y * gridWidth + x].push_back(index);
+		}
+	}
+}
+
+void SpatialGrid::AddRect(const ofRectangle& rect, int owner)
+{
+	Item item;
+	item.bounds = rect;
+	item.bounds.standardize();
+	item.segment = false;
+	item.owner = owner;
+	item.stamp = 0;
+	Insert(item);
+}
+
+void SpatialGrid::AddSegment(const ofPoint& a, const ofPoint& b, int owner)
+{
+	Item item;
+	item.bounds = ofRectangle(a, b);
+	item.a = a;
+	item.b = b;
+	item.segment = true;
+	item.owner = owner;
+	item.stamp = 0;
+	Insert(item);
+}
+
+void SpatialGrid::AddPolyline(const ofPolyline& line, int owner)
+{
+	for (int i = 1; i < line.size(); i++)
+	{
+		AddSegment(line[i - 1], line[i], owner);
+	}
+}
+
+bool SpatialGrid::RectsOverlap(const ofRectangle& a, const ofRectangle& b)
+{
+	return a.getMinX() <= b.getMaxX() && b.getMinX() <= a.getMaxX()
+		&& a.getMinY() <= b.getMaxY() && b.getMinY() <= a.getMaxY();
+}
+
+// Liang-Barsky clip of the segment against the rectangle; if anything is left, they touch.
+bool SpatialGrid::SegmentHitsRect(const ofPoint& a, const ofPoint& b, const ofRectangle& rect)
+{
+	float dx = b.x - a.x;
+	float dy = b.y - a.y;
+	float p[4] = { -dx, dx, -dy, dy };
+	float q[4] = { a.x - rect.getMinX(), rect.getMaxX() - a.x, a.y - rect.getMinY(), rect.getMaxY() - a.y };
+
+	float t0 = 0.0f;
+	float t1 = 1.0f;
+	for (int i = 0; i < 4; i++)
+	{
+		if (p[i] == 0)
+		{
+			if (q[i] < 0)
+				return false;
+			continue;
+		}
+
+		float t = q[i] / p[i];
+		if (p[i] < 0)
+			t0 = std::max(t0, t);
+		else
+			t1 = std::min(t1, t);
+
+		if (t0 > t1)
+			return false;
+	}
+	return true;
+}
+
+bool SpatialGrid::Overlaps(const ofRectangle& rect, int ignoreOwner)
+{
+	queryStamp++;
+
+	int x0, y0, x1, y1;
+	CellRange(rect, x0, y0, x1, y1);
+	for (int y = y0; y <= y1; y++)
+	{
+		for (int x = x0; x <= x1; x++)
+		{
+			for (int index : cells[y * gridWidth + x])
+			{
+				Item& item = items[index];
+				if (item.stamp == queryStamp)
+					continue;
+				item.stamp = queryStamp;
+
+				if (ignoreOwner != noOwner && item.owner == ignoreOwner)
+					continue;
+				if (!RectsOverlap(item.bounds, rect))
+					continue;
+
+				if (!item.segment || SegmentHitsRect(item.a, item.b, rect))
+					return true;
+			}
+		}
+	}
+	return false;
+}
+
+float SpatialGrid::DistanceSquared(const Item& item, const ofPoint& pt)
+{
+	if (!item.segment)
+	{
+		float dx = std::max(0.0f, std::max(item.bounds.getMinX() - pt.x, pt.x - item.bounds.getMaxX()));
+		float dy = std::max(0.0f, std::max(item.bounds.getMinY() - pt.y, pt.y - item.bounds.getMaxY()));
+		return dx * dx + dy * dy;
+	}
+
+	ofPoint ab = item.b - item.a;
+	float lengthSq = ab.x * ab.x + ab.y * ab.y;
+	float t = lengthSq > 0 ? ofClamp(((pt.x - item.a.x) * ab.x + (pt.y - item.a.y) * ab.y) / lengthSq, 0.0f, 1.0f) : 0;
+	float dx = item.a.x + ab.x * t - pt.x;
+	float dy = item.a.y + ab.y * t - pt.y;
+	return dx * dx + dy * dy;
+}
+
+bool SpatialGrid::Near(const ofPoint& pt, float radius)
+{
+	queryStamp++;
+
+	ofRectangle rect(pt.x - radius, pt.y - radius, radius * 2, radius * 2);
+	float radiusSq = radius * radius;
+
+	int x0, y0, x1, y1;
+	CellRange(rect, x0, y0, x1, y1);
+	for (int y = y0; y <= y1; y++)
+	{
+		for (int x = x0; x <= x1; x++)
+		{
+			for (int index : cells[y * gridWidth + x])
+			{
+				Item& item = items[index];
+				if (item.stamp == queryStamp)
+					continue;
+				item.stamp = queryStamp;
+
+				if (!RectsOverlap(item.bounds, rect))
+					continue;
+
+				if (DistanceSquared(item, pt) < radiusSq)
+					return true;
+			}
+		}
+	}
+	return false;
+}
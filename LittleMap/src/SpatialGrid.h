@@ -0,0 +1,53 @@
+#pragma once
+#include "ofMain.h"
+
+#include <vector>
+
+// Uniform bucket grid over the map. Holds rectangles and line segments and
+// answers "does this rectangle hit anything" by only looking at nearby cells.
+// Anything can be given an owner, which Overlaps can be told to look past.
+class SpatialGrid
+{
+public:
+	static const int noOwner = -1;
+
+	SpatialGrid();
+	~SpatialGrid();
+
+	void Setup(float width, float height, float cellSize);
+	void Clear();
+
+	void AddRect(const ofRectangle& rect, int owner = noOwner);
+	void AddSegment(const ofPoint& a, const ofPoint& b, int owner = noOwner);
+	void AddPolyline(const ofPolyline& line, int owner = noOwner);
+
+	// ignoring anything of ignoreOwner's
+	bool Overlaps(const ofRectangle& rect, int ignoreOwner = noOwner);
+	// true if anything is closer than radius to pt
+	bool Near(const ofPoint& pt, float radius);
+
+private:
+	struct Item {
+		ofRectangle bounds;
+		ofPoint a;
+		ofPoint b;
+		bool segment;
+		int owner;
+		unsigned int stamp;
+	};
+
+	void Insert(const Item& item);
+	void CellRange(const ofRectangle& rect, int& x0, int& y0, int& x1, int& y1);
+	bool RectsOverlap(const ofRectangle& a, const ofRectangle& b);
+	bool SegmentHitsRect(const ofPoint& a, const ofPoint& b, const ofRectangle& rect);
+	float DistanceSquared(const Item& item, const ofPoint& pt);
+
+	float cellSize;
+	int gridWidth;
+	int gridHeight;
+	vector<vector<int>> cells;
+	vector<Item> items;
+
+	// bumped per query so items spanning several cells are only tested once
+	unsigned int queryStamp;
+};
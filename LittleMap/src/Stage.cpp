@@ -1,4 +1,5 @@
 #include "Stage.h"
+#include "ofMain.h"
 
 Stage::Stage()
 {
@@ -7,3 +8,11 @@ Stage::Stage()
 Stage::~Stage()
 {
 }
+
+void Stage::DrawLevel(float scale)
+{
+	ofPushMatrix();
+	ofScale(scale, scale);
+	Draw();
+	ofPopMatrix();
+}
@@ -1,4 +1,9 @@
 #pragma once
+#include <vector>
+
+class SnapshotWriter;
+class SnapshotReader;
+
 class Stage
 {
 public:
@@ -6,11 +11,30 @@ public:
 	~Stage();
 
 	virtual void Setup() {};
+	// CPU only work, run on the worker thread before Render. Called until it returns true,
+	// and mustn't touch GL; Render then uploads and draws what it made.
+	virtual bool Generate() { return true; };
 	virtual bool Render() { return true; };
 	virtual void Draw() {};
+	// Draws the finished stage shrunk by scale, for the zoom levels of a pyramid export.
+	// By default that's just Draw scaled down; stages with the shapes to hand redraw them.
+	virtual void DrawLevel(float scale);
 	virtual void Reset() {};
 	virtual void DebugNum(int key) {};
 	virtual void DebugClick(int x, int y) {};
 	virtual char* GetMessage() { return nullptr; };
+
+	// Saves what Generate made. Stages that are quick to make, or only draw, keep nothing.
+	virtual bool WriteSnapshot(SnapshotWriter& out) { return false; };
+	// Puts back what WriteSnapshot saved, as if Generate had just finished; Render still runs.
+	virtual bool ReadSnapshot(SnapshotReader& in) { return false; };
+
+	// The stages this one reads from. It won't be started until they've all finished,
+	// and anything that doesn't depend on it may run alongside it.
+	void DependsOn(Stage* stage) { inputs.push_back(stage); }
+	const std::vector<Stage*>& GetInputs() const { return inputs; }
+
+private:
+	std::vector<Stage*> inputs;
 };
 
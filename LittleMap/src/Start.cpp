@@ -1,6 +1,9 @@
 #include "Start.h"
+#include "Snapshot.h"
 
-#include "Noise.h"
+// ofNoise's classic permutation and offsets, for the same terrain as before the noise was seeded;
+// only the terrain, everything drawn on it uses the map's own random streams either way
+bool compatibleNoise = false;
 
 Start::Start()
 {
@@ -19,5 +22,20 @@ void Start::Reset()
 {
 	int seed = (int)std::time(nullptr);
 	printf("Seed: %d\n", seed);
-	SetNoiseSeed(seed);
+	generator.SetNoiseMode(compatibleNoise ? NoiseCompatible : NoiseSeeded);
+	generator.Seed(seed);
+}
+
+// the seed is in every snapshot's header, there's nothing else to keep
+bool Start::WriteSnapshot(SnapshotWriter& out)
+{
+	return true;
+}
+
+bool Start::ReadSnapshot(SnapshotReader& in)
+{
+	printf("Seed: %d (from snapshot)\n", in.GetSeed());
+	generator.SetNoiseMode(compatibleNoise ? NoiseCompatible : NoiseSeeded);
+	generator.Seed(in.GetSeed());
+	return true;
 }
\ No newline at end of file
@@ -2,6 +2,8 @@
 #include "Stage.h"
 #include "ofMain.h"
 
+#include "Generator.h"
+
 class Start : public Stage
 {
 public:
@@ -10,5 +12,12 @@ public:
 
 	virtual void Setup();
 	virtual void Reset();
+	virtual bool WriteSnapshot(SnapshotWriter& out);
+	virtual bool ReadSnapshot(SnapshotReader& in);
+
+	Generator& GetGenerator() { return generator; }
+
+private:
+	Generator generator;
 };
 
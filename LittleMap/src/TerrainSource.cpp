@@ -0,0 +1,289 @@
+#include "TerrainSource.h"
+
+#include <climits>
+#include <cstring>
+
+// raster heights become land values as (height - rasterSeaLevel) * rasterHeightScale,
+// so by default 1000 units above sea level is about as high as the noise goes
+float rasterSeaLevel = 0.0f;
+float rasterHeightScale = 0.0005f;
+// what the noise can give, and what anything off the raster or missing becomes
+const float lowestLand = -0.45f;
+const float highestLand = 0.55f;
+
+// TIFF tags and types this reads
+enum TiffTag {
+	TagImageWidth = 256,
+	TagImageLength = 257,
+	TagBitsPerSample = 258,
+	TagCompression = 259,
+	TagStripOffsets = 273,
+	TagSamplesPerPixel = 277,
+	TagRowsPerStrip = 278,
+	TagTileWidth = 322,
+	TagTileLength = 323,
+	TagTileOffsets = 324,
+	TagSampleFormat = 339,
+};
+const int tiffShort = 3;
+const int tiffLong = 4;
+const int tiffLong8 = 16;
+const int sampleFormatFloat = 3;
+
+NoiseTerrain::NoiseTerrain(const Generator& generator, float scale, const NoiseOctaves& octaves, float seaLevel)
+	: generator(generator)
+	, scale(scale)
+	, octaves(octaves)
+	, seaLevel(seaLevel)
+{
+}
+
+void NoiseTerrain::LandRow(float* out, int count, float startX, float stepX, float y) const
+{
+	generator.NoiseRow(out, count, startX, stepX, y, scale, octaves);
+	for (int x = 0; x < count; x++)
+	{
+		out[x] -= seaLevel;
+	}
+}
+
+RasterTerrain::RasterTerrain()
+	: swapBytes(false)
+	, width(0)
+	, height(0)
+	, blockWidth(0)
+	, blockHeight(0)
+	, blocksAcross(0)
+{
+}
+
+void RasterTerrain::Close()
+{
+	file.Close();
+	width = 0;
+	height = 0;
+	blockOffsets.clear();
+}
+
+bool RasterTerrain::Open(const std::string& path)
+{
+	Close();
+	if (!file.Open(path))
+	{
+		printf("Couldn't open terrain %s\n", path.c_str());
+		return false;
+	}
+
+	std::string ext = ofToLower(ofFilePath::getFileExt(path));
+	bool opened = ext == "tif" || ext == "tiff" ? OpenTiff() : OpenRaw(path);
+	if (!opened)
+	{
+		printf("Couldn't read terrain %s, it needs to be a 32 bit float raster\n", path.c_str());
+		Close();
+		return false;
+	}
+
+	printf("Terrain %s: %dx%d in %d blocks, %.1fMB\n", path.c_str(), width, height,
+		(int)blockOffsets.size(), file.GetSize() / (1024.0f * 1024.0f));
+	return true;
+}
+
+bool RasterTerrain::OpenRaw(const std::string& path)
+{
+	std::string name = ofFilePath::getBaseName(path);
+	size_t size = name.rfind('_');
+	if (size == std::string::npos || sscanf(name.c_str() + size + 1, "%dx%d", &width, &height) != 2)
+		return false;
+	if (width <= 0 || height <= 0 || (uint64_t)width * height * 4 > file.GetSize())
+		return false;
+
+	swapBytes = false;
+	blockWidth = width;
+	blockHeight = height;
+	blocksAcross = 1;
+	blockOffsets.assign(1, 0);
+	return true;
+}
+
+bool RasterTerrain::OpenTiff()
+{
+	// the header is 8 bytes, or 16 for BigTIFF, which is checked once the version is known
+	if (file.GetSize() < 8)
+		return false;
+	char data[2];
+	file.Read(0, data, 2);
+	uint16_t probe = 1;
+	bool hostLittle = *(const char*)&probe == 1;
+	if (data[0] == 'I' && data[1] == 'I')
+		swapBytes = !hostLittle;
+	else if (data[0] == 'M' && data[1] == 'M')
+		swapBytes = hostLittle;
+	else
+		return false;
+
+	uint16_t version = Read16(2);
+	bool big = version == 43;
+	if (version != 42 && !big)
+		return false;
+	if (big && file.GetSize() < 16)
+		return false;
+
+	// only the first image is read
+	uint64_t ifd = big ? Read64(8) : Read32(4);
+	uint64_t entries = big ? Read64(ifd) : Read16(ifd);
+	uint64_t entryStart = ifd + (big ? 8 : 2);
+	int entrySize = big ? 20 : 12;
+	if (!InFile(ifd, big ? 8 : 2) || entries > file.GetSize() || !InFile(entryStart, entries * entrySize))
+		return false;
+
+	uint64_t bits = 0;
+	uint64_t compression = 1;
+	uint64_t samples = 1;
+	uint64_t format = 1;
+	uint64_t rowsPerStrip = 0;
+	uint64_t tileWidth = 0;
+	uint64_t tileLength = 0;
+	uint64_t imageWidth = 0;
+	uint64_t imageLength = 0;
+	for (uint64_t i = 0; i < entries; i++)
+	{
+		uint64_t entry = entryStart + i * entrySize;
+		uint16_t tag = Read16(entry);
+		uint16_t type = Read16(entry + 2);
+		uint64_t count = big ? Read64(entry + 4) : Read32(entry + 4);
+		uint64_t valueAt = entry + (big ? 12 : 8);
+
+		// everything needed is a whole number of one of these
+		int typeSize = type == tiffShort ? 2 : type == tiffLong ? 4 : type == tiffLong8 ? 8 : 0;
+		if (typeSize == 0 || count == 0 || count > file.GetSize())
+			continue;
+		// values that don't fit in the entry are somewhere else
+		if (count * typeSize > (uint64_t)(big ? 8 : 4))
+			valueAt = big ? Read64(valueAt) : Read32(valueAt);
+		if (!InFile(valueAt, count * typeSize))
+			return false;
+
+		auto value = [&](uint64_t k) -> uint64_t {
+			uint64_t at = valueAt + k * typeSize;
+			return typeSize == 2 ? Read16(at) : typeSize == 4 ? Read32(at) : Read64(at);
+		};
+
+		switch (tag)
+		{
+		case TagImageWidth: imageWidth = value(0); break;
+		case TagImageLength: imageLength = value(0); break;
+		case TagBitsPerSample: bits = value(0); break;
+		case TagCompression: compression = value(0); break;
+		case TagSamplesPerPixel: samples = value(0); break;
+		case TagRowsPerStrip: rowsPerStrip = value(0); break;
+		case TagTileWidth: tileWidth = value(0); break;
+		case TagTileLength: tileLength = value(0); break;
+		case TagSampleFormat: format = value(0); break;
+		case TagStripOffsets:
+		case TagTileOffsets:
+			blockOffsets.resize(count);
+			for (uint64_t k = 0; k < count; k++)
+				blockOffsets[k] = value(k);
+			break;
+		}
+	}
+
+	if (bits != 32 || format != sampleFormatFloat || compression != 1 || samples != 1)
+		return false;
+	if (imageWidth == 0 || imageLength == 0 || imageWidth > INT_MAX || imageLength > INT_MAX)
+		return false;
+	width = (int)imageWidth;
+	height = (int)imageLength;
+
+	if (tileWidth > 0 && tileLength > 0)
+	{
+		blockWidth = (int)std::min<uint64_t>(tileWidth, INT_MAX);
+		blockHeight = (int)std::min<uint64_t>(tileLength, INT_MAX);
+	}
+	else
+	{
+		// no RowsPerStrip means one strip
+		blockWidth = width;
+		blockHeight = rowsPerStrip == 0 ? height : (int)std::min<uint64_t>(rowsPerStrip, height);
+	}
+	blocksAcross = (width + blockWidth - 1) / blockWidth;
+	uint64_t blocksDown = (height + blockHeight - 1) / blockHeight;
+	return blockOffsets.size() >= blocksAcross * blocksDown;
+}
+
+// written so nothing can wrap around, whatever offsets the file has in it
+bool RasterTerrain::InFile(uint64_t offset, uint64_t length) const
+{
+	return offset <= file.GetSize() && file.GetSize() - offset >= length;
+}
+
+uint16_t RasterTerrain::Read16(uint64_t offset) const
+{
+	uint16_t v = 0;
+	if (!file.Read(offset, &v, 2))
+		return 0;
+	return swapBytes ? (uint16_t)((v >> 8) | (v << 8)) : v;
+}
+
+uint32_t RasterTerrain::Read32(uint64_t offset) const
+{
+	uint32_t v = 0;
+	if (!file.Read(offset, &v, 4))
+		return 0;
+	if (swapBytes)
+		v = (v >> 24) | ((v >> 8) & 0xff00) | ((v << 8) & 0xff0000) | (v << 24);
+	return v;
+}
+
+uint64_t RasterTerrain::Read64(uint64_t offset) const
+{
+	uint64_t v = 0;
+	if (!file.Read(offset, &v, 8))
+		return 0;
+	if (swapBytes)
+	{
+		uint64_t swapped = 0;
+		for (int i = 0; i < 8; i++)
+			swapped |= ((v >> (i * 8)) & 0xff) << ((7 - i) * 8);
+		v = swapped;
+	}
+	return v;
+}
+
+float RasterTerrain::Height(int x, int y) const
+{
+	if (x < 0 || y < 0 || x >= width || y >= height)
+		return NAN;
+
+	int block = (y / blockHeight) * blocksAcross + x / blockWidth;
+	uint64_t within = ((uint64_t)(y % blockHeight) * blockWidth + x % blockWidth) * 4;
+	uint64_t start = blockOffsets[block];
+	if (!InFile(start, within + 4))
+		return NAN;
+	uint64_t offset = start + within;
+	uint32_t bits = Read32(offset);
+	float h;
+	memcpy(&h, &bits, 4);
+	return h;
+}
+
+void RasterTerrain::LandRow(float* out, int count, float startX, float stepX, float y) const
+{
+	// the whole raster fits in the window, in the middle, with sea around it
+	float scale = std::max((float)width / ofGetWidth(), (float)height / ofGetHeight());
+	float offsetX = (width - ofGetWidth() * scale) * 0.5f;
+	float offsetY = (height - ofGetHeight() * scale) * 0.5f;
+
+	// nearest sample to each pixel's middle; only those pages are ever touched
+	int ry = (int)std::floor((y + 0.5f) * scale + offsetY);
+	for (int i = 0; i < count; i++)
+	{
+		int rx = (int)std::floor((startX + i * stepX + 0.5f) * scale + offsetX);
+		float h = Height(rx, ry);
+		// NaN, or a no data value far below anything real
+		if (h != h || h < -1e30f)
+			out[i] = lowestLand;
+		else
+			out[i] = std::min(highestLand, std::max(lowestLand, (h - rasterSeaLevel) * rasterHeightScale));
+	}
+}
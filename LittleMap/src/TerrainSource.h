@@ -0,0 +1,78 @@
+#pragma once
+#include "ofMain.h"
+
+#include "Generator.h"
+#include "MappedFile.h"
+
+#include <stdint.h>
+
+// Where CurveTerrain's land values come from. Land is above 0 and sea below, roughly within
+// -0.45 to 0.55 like the noise. Read from the worker, so LandRow mustn't change anything but
+// a raster's mapped window, which only CurveTerrain's one stage moves.
+class TerrainSource
+{
+public:
+	virtual ~TerrainSource() {}
+
+	// out[i] = the land value at (startX + i * stepX, y), in map pixels
+	virtual void LandRow(float* out, int count, float startX, float stepX, float y) const = 0;
+};
+
+// The procedural land, from the map's seeded noise.
+class NoiseTerrain : public TerrainSource
+{
+public:
+	NoiseTerrain(const Generator& generator, float scale, const NoiseOctaves& octaves, float seaLevel);
+
+	virtual void LandRow(float* out, int count, float startX, float stepX, float y) const;
+
+private:
+	const Generator& generator;
+	float scale;
+	NoiseOctaves octaves;
+	float seaLevel;
+};
+
+// A float heightfield on disk, fitted to the map window. The file is mapped a window at a time
+// rather than read, so only the pages under the pixels the map samples are ever loaded, and
+// its size is only limited by 64 bit offsets, even in a 32 bit build.
+// Reads 32 bit float rasters, either raw with the size in the name (name_<width>x<height>.raw,
+// little endian, rows top to bottom) or uncompressed single channel TIFF or BigTIFF, in strips
+// or tiles, as GeoTIFF exports usually are.
+class RasterTerrain : public TerrainSource
+{
+public:
+	RasterTerrain();
+
+	bool Open(const std::string& path);
+	void Close();
+	bool IsOpen() const { return file.IsOpen(); }
+
+	int GetWidth() const { return width; }
+	int GetHeight() const { return height; }
+
+	virtual void LandRow(float* out, int count, float startX, float stepX, float y) const;
+
+private:
+	bool OpenRaw(const std::string& path);
+	bool OpenTiff();
+
+	// whether length bytes from offset are all in the file
+	bool InFile(uint64_t offset, uint64_t length) const;
+	uint16_t Read16(uint64_t offset) const;
+	uint32_t Read32(uint64_t offset) const;
+	uint64_t Read64(uint64_t offset) const;
+	// the raster's height at a pixel, or NaN off the raster or past the end of the file
+	float Height(int x, int y) const;
+
+	MappedFile file;
+	bool swapBytes;
+	int width;
+	int height;
+
+	// Strips are blocks as wide as the raster, and a raw file is one block of the whole thing.
+	int blockWidth;
+	int blockHeight;
+	int blocksAcross;
+	vector<uint64_t> blockOffsets;
+};
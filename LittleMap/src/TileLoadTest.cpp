@@ -0,0 +1,125 @@
+#include "TileLoadTest.h"
+#include "Socket.h"
+#include "Random.h"
+
+#include <chrono>
+#include <cstring>
+
+// tiles are picked from a square this many tiles across at each zoom
+const int loadTestArea = 6;
+// as many as the server has
+const int loadTestZoomLevels = 3;
+// how often a client asks for one of a few popular tiles instead, to exercise the cache
+// and the coalescing
+const float loadTestHotChance = 0.3f;
+
+TileLoadTest::TileLoadTest()
+	: running(false)
+{
+}
+
+TileLoadTest::~TileLoadTest()
+{
+	if (thread.joinable())
+		thread.join();
+}
+
+void TileLoadTest::Start(int port, int seed, int clients, int requestsPerClient)
+{
+	if (running)
+		return;
+	if (thread.joinable())
+		thread.join();
+
+	running = true;
+	thread = std::thread(&TileLoadTest::Run, this, port, seed, clients, requestsPerClient);
+}
+
+TileLoadTest::Result TileLoadTest::Request(int port, const std::string& path)
+{
+	std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+	Result result{ 0, 0, 0 };
+
+	Socket socket;
+	if (socket.Connect(port))
+	{
+		socket.SetTimeout(10000);
+		std::string request = "GET " + path + " HTTP/1.1\r\nHost: 127.0.0.1\r\nConnection: close\r\n\r\n";
+		if (socket.SendAll(request.data(), request.size()))
+		{
+			// the server closes once it's sent everything
+			std::string response;
+			char buffer[16384];
+			int received;
+			while ((received = socket.Receive(buffer, sizeof(buffer))) > 0)
+			{
+				response.append(buffer, received);
+			}
+			sscanf(response.c_str(), "HTTP/1.1 %d", &result.status);
+			result.bytes = response.size();
+		}
+	}
+
+	result.ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+	return result;
+}
+
+void TileLoadTest::Run(int port, int seed, int clients, int requestsPerClient)
+{
+	printf("Load test: %d clients, %d requests each\n", clients, requestsPerClient);
+	std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+	vector<vector<Result>> results(clients);
+	vector<std::thread> threads;
+	for (int c = 0; c < clients; c++)
+	{
+		threads.push_back(std::thread([&, c]() {
+			Random rng(c + 1);
+			for (int i = 0; i < requestsPerClient; i++)
+			{
+				int z = rng.Int(loadTestZoomLevels);
+				int x = rng.Int(loadTestArea) - loadTestArea / 2;
+				int y = rng.Int(loadTestArea) - loadTestArea / 2;
+				if (rng.Float() < loadTestHotChance)
+				{
+					z = loadTestZoomLevels - 1;
+					x = rng.Int(2);
+					y = 0;
+				}
+				char path[128];
+				snprintf(path, sizeof(path), "/tiles/%d/%d/%d/%d.png", seed, z, x, y);
+				results[c].push_back(Request(port, path));
+			}
+		}));
+	}
+	for (auto& thread : threads)
+	{
+		thread.join();
+	}
+	float seconds = std::chrono::duration<float>(std::chrono::steady_clock::now() - startTime).count();
+
+	vector<float> latencies;
+	int ok = 0;
+	int failed = 0;
+	size_t bytes = 0;
+	for (auto& client : results)
+	{
+		for (auto& result : client)
+		{
+			latencies.push_back(result.ms);
+			bytes += result.bytes;
+			if (result.status == 200)
+				ok++;
+			else
+				failed++;
+		}
+	}
+	std::sort(latencies.begin(), latencies.end());
+	auto percentile = [&](float p) {
+		return latencies.empty() ? 0.0f : latencies[std::min(latencies.size() - 1, (size_t)(p * latencies.size()))];
+	};
+
+	printf("Load test: %d ok, %d failed in %.2fs, %.1f tiles/s, %.1fMB\n", ok, failed, seconds, ok / seconds, bytes / (1024.0f * 1024.0f));
+	printf("Latency ms: p50 %.2f, p90 %.2f, p99 %.2f, max %.2f\n", percentile(0.5f), percentile(0.9f), percentile(0.99f), percentile(1.0f));
+	running = false;
+}
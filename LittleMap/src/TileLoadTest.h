@@ -0,0 +1,32 @@
+#pragma once
+#include "ofMain.h"
+
+#include <thread>
+#include <atomic>
+
+// A local client for TileServer: a few connections at once asking for tiles around the
+// origin, some of them over and over, then a report of tiles per second and latencies.
+// Runs on its own thread, so the app keeps drawing meanwhile.
+class TileLoadTest
+{
+public:
+	TileLoadTest();
+	~TileLoadTest();
+
+	// does nothing if a run is still going
+	void Start(int port, int seed, int clients, int requestsPerClient);
+	bool IsRunning() const { return running; }
+
+private:
+	struct Result {
+		float ms;
+		int status;
+		size_t bytes;
+	};
+
+	void Run(int port, int seed, int clients, int requestsPerClient);
+	static Result Request(int port, const std::string& path);
+
+	std::thread thread;
+	std::atomic<bool> running;
+};
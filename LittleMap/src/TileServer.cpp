@@ -0,0 +1,427 @@
+#include "TileServer.h"
+
+#include <chrono>
+#include <climits>
+#include <cstring>
+
+const int tileServerThreads = 4;
+// connections waiting for a worker before new ones are turned away
+const int tileServerQueue = 64;
+const int tileRequestTimeout = 5000;
+// requests whose headers don't end within this many bytes are turned away
+const size_t tileRequestBytes = 8192;
+const int tileZoomLevels = 3;
+const size_t tileCacheBytes = 64 * 1024 * 1024;
+const int tileChunkCache = 96;
+// part of every ETag; bump it whenever tiles would come out differently for the same seed
+const int tileVersion = 1;
+
+static std::string FindHeader(const std::string& request, const char* name)
+{
+	size_t length = strlen(name);
+	size_t line = request.find("\r\n");
+	while (line != std::string::npos && line + 2 < request.size())
+	{
+		size_t start = line + 2;
+		line = request.find("\r\n", start);
+		if (line == std::string::npos)
+			break;
+		if (line - start > length && request[start + length] == ':')
+		{
+			bool match = true;
+			for (size_t i = 0; i < length && match; i++)
+				match = tolower(request[start + i]) == tolower(name[i]);
+			if (match)
+			{
+				size_t value = request.find_first_not_of(' ', start + length + 1);
+				return value < line ? request.substr(value, line - value) : "";
+			}
+		}
+	}
+	return "";
+}
+
+TileServer::TileServer(World& world)
+	: world(world)
+	, port(0)
+	, running(false)
+	, tileBytes(0)
+	, requests(0)
+	, rendered(0)
+	, renderTime(0)
+	, cacheHits(0)
+	, coalesced(0)
+	, notModified(0)
+	, rejected(0)
+{
+}
+
+TileServer::~TileServer()
+{
+	Stop();
+}
+
+bool TileServer::Start(int port)
+{
+	Stop();
+	if (!listener.Listen(port, tileServerQueue))
+	{
+		printf("Tile server couldn't listen on port %d\n", port);
+		return false;
+	}
+
+	this->port = port;
+	running = true;
+	acceptThread = std::thread(&TileServer::AcceptLoop, this);
+	for (int i = 0; i < tileServerThreads; i++)
+	{
+		workers.push_back(std::thread(&TileServer::WorkerLoop, this));
+	}
+	printf("Serving tiles on http://127.0.0.1:%d/tiles/<seed>/<z>/<x>/<y>.png\n", port);
+	return true;
+}
+
+void TileServer::Stop()
+{
+	if (!running)
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		running = false;
+	}
+	wake.notify_all();
+	acceptThread.join();
+	for (auto& worker : workers)
+	{
+		worker.join();
+	}
+	workers.clear();
+	connections.clear();
+	listener.Close();
+	printf("Tile server stopped\n");
+}
+
+void TileServer::AcceptLoop()
+{
+	while (running)
+	{
+		// wakes up now and then to see if it's been stopped
+		if (!listener.WaitReadable(100))
+			continue;
+
+		Socket client = listener.Accept();
+		if (!client.IsValid())
+			continue;
+		client.SetTimeout(tileRequestTimeout);
+
+		std::unique_lock<std::mutex> lock(mutex);
+		if (connections.size() >= tileServerQueue)
+		{
+			rejected++;
+			lock.unlock();
+			Respond(client, "503 Service Unavailable", "Retry-After: 1\r\n", nullptr, 0);
+			continue;
+		}
+		connections.push_back(std::move(client));
+		wake.notify_one();
+	}
+}
+
+void TileServer::WorkerLoop()
+{
+	while (true)
+	{
+		Socket client;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [this]() { return !running || !connections.empty(); });
+			if (!running)
+				return;
+			client = std::move(connections.front());
+			connections.pop_front();
+		}
+		Handle(client);
+	}
+}
+
+void TileServer::Respond(Socket& client, const char* status, const std::string& headers, const char* body, size_t size)
+{
+	char head[256];
+	snprintf(head, sizeof(head), "HTTP/1.1 %s\r\nContent-Length: %d\r\nConnection: close\r\n", status, (int)size);
+	std::string response = head + headers + "\r\n";
+	if (client.SendAll(response.data(), response.size()) && size > 0)
+		client.SendAll(body, size);
+}
+
+// One request per connection, which is all the viewer needs.
+void TileServer::Handle(Socket& client)
+{
+	std::string request;
+	char buffer[2048];
+	while (request.find("\r\n\r\n") == std::string::npos && request.size() < tileRequestBytes)
+	{
+		int received = client.Receive(buffer, sizeof(buffer));
+		if (received <= 0)
+			return;
+		request.append(buffer, received);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		requests++;
+	}
+
+	// only ever a truncated request, which isn't worth parsing
+	if (request.find("\r\n\r\n") == std::string::npos)
+	{
+		Respond(client, "431 Request Header Fields Too Large", "", nullptr, 0);
+		return;
+	}
+
+	int seed, z, x, y;
+	char extension[8] = "";
+	if (request.compare(0, 4, "GET ") != 0)
+	{
+		Respond(client, "405 Method Not Allowed", "Allow: GET\r\n", nullptr, 0);
+		return;
+	}
+	// far enough out that RenderTile's chunk coordinates, and their pixels, would overflow
+	int maxTile = INT_MAX / ((1 << (tileZoomLevels - 1)) * world.GetChunkSize()) - 2;
+	if (sscanf(request.c_str() + 4, "/tiles/%d/%d/%d/%d.%3s", &seed, &z, &x, &y, extension) != 5
+		|| strcmp(extension, "png") != 0 || z < 0 || z >= tileZoomLevels
+		|| x < -maxTile || x > maxTile || y < -maxTile || y > maxTile)
+	{
+		Respond(client, "404 Not Found", "", nullptr, 0);
+		return;
+	}
+
+	// a tile never changes for the same seed and version, so the viewer can keep it
+	TileKey key(seed, z, x, y);
+	std::string etag = ETag(key);
+	std::string headers = "ETag: " + etag + "\r\nCache-Control: public, max-age=86400\r\nAccess-Control-Allow-Origin: *\r\n";
+	if (FindHeader(request, "If-None-Match") == etag)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			notModified++;
+		}
+		Respond(client, "304 Not Modified", headers, nullptr, 0);
+		return;
+	}
+
+	TileData png = GetTile(key);
+	if (!png)
+	{
+		Respond(client, "500 Internal Server Error", "", nullptr, 0);
+		return;
+	}
+	Respond(client, "200 OK", headers + "Content-Type: image/png\r\n", png->data(), png->size());
+}
+
+std::string TileServer::ETag(const TileKey& key)
+{
+	// FNV-1a over everything a tile depends on
+	int values[] = { std::get<0>(key), std::get<1>(key), std::get<2>(key), std::get<3>(key),
+		tileVersion, tileZoomLevels, world.GetChunkSize() };
+	uint64_t hash = 0xcbf29ce484222325ull;
+	for (int value : values)
+	{
+		for (int i = 0; i < 4; i++)
+		{
+			hash ^= (value >> (i * 8)) & 0xff;
+			hash *= 0x100000001b3ull;
+		}
+	}
+	char etag[24];
+	snprintf(etag, sizeof(etag), "\"%016llx\"", (unsigned long long)hash);
+	return etag;
+}
+
+TileServer::TileData TileServer::GetTile(const TileKey& key)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+
+	auto cached = tiles.find(key);
+	if (cached != tiles.end())
+	{
+		cacheHits++;
+		tileLru.splice(tileLru.end(), tileLru, cached->second.lru);
+		return cached->second.png;
+	}
+
+	// someone's already drawing it
+	auto inFlight = pending.find(key);
+	if (inFlight != pending.end())
+	{
+		coalesced++;
+		std::shared_ptr<PendingTile> tile = inFlight->second;
+		tileReady.wait(lock, [&]() { return tile->done; });
+		return tile->png;
+	}
+
+	std::shared_ptr<PendingTile> tile = std::make_shared<PendingTile>();
+	pending[key] = tile;
+	lock.unlock();
+
+	std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+	ofPixels pixels;
+	RenderTile(key, pixels);
+	ofBuffer buffer;
+	TileData png;
+	if (ofSaveImage(pixels, buffer, OF_IMAGE_FORMAT_PNG))
+		png = std::make_shared<const std::string>(buffer.getData(), buffer.size());
+	float elapsed = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+
+	lock.lock();
+	rendered++;
+	renderTime += elapsed;
+	tile->png = png;
+	tile->done = true;
+	pending.erase(key);
+	tileReady.notify_all();
+
+	if (png)
+	{
+		tiles[key] = CachedTile{ png, tileLru.insert(tileLru.end(), key) };
+		tileBytes += png->size();
+		while (tileBytes > tileCacheBytes && !tileLru.empty())
+		{
+			auto oldest = tiles.find(tileLru.front());
+			tileBytes -= oldest->second.png->size();
+			tiles.erase(oldest);
+			tileLru.pop_front();
+		}
+	}
+	lock.unlock();
+
+	return png;
+}
+
+TileServer::ChunkData TileServer::GetChunk(int seed, int x, int y)
+{
+	ChunkKey key(seed, x, y);
+	{
+		std::lock_guard<std::mutex> lock(chunkMutex);
+		auto cached = chunks.find(key);
+		if (cached != chunks.end())
+		{
+			chunkLru.splice(chunkLru.end(), chunkLru, cached->second.lru);
+			return cached->second.contents;
+		}
+	}
+
+	// Tiles sharing a chunk might both make it; the tile level coalescing catches the
+	// common case, and whichever finishes second is just dropped.
+	std::shared_ptr<World::ChunkContents> contents = std::make_shared<World::ChunkContents>();
+	world.GenerateChunk(seed, x, y, *contents);
+
+	std::lock_guard<std::mutex> lock(chunkMutex);
+	if (chunks.find(key) == chunks.end())
+	{
+		chunks[key] = CachedChunk{ contents, chunkLru.insert(chunkLru.end(), key) };
+		while (chunks.size() > tileChunkCache)
+		{
+			chunks.erase(chunkLru.front());
+			chunkLru.pop_front();
+		}
+	}
+	return contents;
+}
+
+// The fill, then the stipples as anti-aliased dots, clipped to the chunk as the GPU does it.
+void TileServer::DrawChunk(const World::ChunkContents& chunk, ofPixels& scratch)
+{
+	int size = world.GetChunkSize();
+	memcpy(scratch.getData(), chunk.fill.getData(), size * size * 3);
+
+	unsigned char* data = scratch.getData();
+	for (auto& stipple : chunk.stipples)
+	{
+		int x0 = std::max(0, (int)std::floor(stipple.pos.x - stipple.radius));
+		int y0 = std::max(0, (int)std::floor(stipple.pos.y - stipple.radius));
+		int x1 = std::min(size - 1, (int)std::ceil(stipple.pos.x + stipple.radius));
+		int y1 = std::min(size - 1, (int)std::ceil(stipple.pos.y + stipple.radius));
+		for (int py = y0; py <= y1; py++)
+		{
+			for (int px = x0; px <= x1; px++)
+			{
+				float distance = ofPoint(px + 0.5f, py + 0.5f).distance(stipple.pos);
+				float coverage = std::min(1.0f, std::max(0.0f, stipple.radius - distance + 0.5f));
+				if (coverage <= 0)
+					continue;
+				unsigned char* pixel = &data[(py * size + px) * 3];
+				for (int c = 0; c < 3; c++)
+					pixel[c] = (unsigned char)(pixel[c] * (1 - coverage));
+			}
+		}
+	}
+}
+
+void TileServer::RenderTile(const TileKey& key, ofPixels& out)
+{
+	int seed = std::get<0>(key);
+	int zoom = 1 << (tileZoomLevels - 1 - std::get<1>(key));
+	int chunkX = std::get<2>(key) * zoom;
+	int chunkY = std::get<3>(key) * zoom;
+	int size = world.GetChunkSize();
+	int cell = size / zoom;
+
+	out.allocate(size, size, 3);
+	ofPixels scratch;
+	scratch.allocate(size, size, 3);
+	for (int j = 0; j < zoom; j++)
+	{
+		for (int i = 0; i < zoom; i++)
+		{
+			ChunkData chunk = GetChunk(seed, chunkX + i, chunkY + j);
+			DrawChunk(*chunk, scratch);
+
+			// box filtered down into its part of the tile
+			const unsigned char* src = scratch.getData();
+			unsigned char* dest = out.getData();
+			for (int y = 0; y < cell; y++)
+			{
+				for (int x = 0; x < cell; x++)
+				{
+					int sum[3] = { 0, 0, 0 };
+					for (int sy = y * zoom; sy < (y + 1) * zoom; sy++)
+					{
+						for (int sx = x * zoom; sx < (x + 1) * zoom; sx++)
+						{
+							for (int c = 0; c < 3; c++)
+								sum[c] += src[(sy * size + sx) * 3 + c];
+						}
+					}
+					unsigned char* pixel = &dest[((j * cell + y) * size + i * cell + x) * 3];
+					for (int c = 0; c < 3; c++)
+						pixel[c] = sum[c] / (zoom * zoom);
+				}
+			}
+		}
+	}
+
+	// Landmarks from the chunks around the tile too, since their icons can hang over into it.
+	// Placement alone is much cheaper than the whole chunk.
+	ofPoint origin(chunkX * size, chunkY * size);
+	vector<Landmarks::Landmark> landmarks;
+	for (int j = -1; j <= zoom; j++)
+	{
+		for (int i = -1; i <= zoom; i++)
+		{
+			world.GenerateLandmarks(seed, chunkX + i, chunkY + j, landmarks);
+			for (auto& landmark : landmarks)
+			{
+				world.BlendIcon(landmark, out, origin, zoom);
+			}
+		}
+	}
+}
+
+void TileServer::PrintStats()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	printf("Tile server: %d requests, %d rendered (%.2fms each), %d cache hits, %d coalesced, %d not modified, %d turned away, %d tiles (%.1fMB) cached\n",
+		requests, rendered, rendered > 0 ? renderTime / rendered : 0.0f, cacheHits, coalesced, notModified, rejected,
+		(int)tiles.size(), tileBytes / (1024.0f * 1024.0f));
+}
@@ -0,0 +1,99 @@
+#pragma once
+#include "ofMain.h"
+
+#include "World.h"
+#include "Socket.h"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <map>
+#include <memory>
+#include <tuple>
+#include <atomic>
+
+// Serves the endless world as XYZ tiles on loopback, for the web viewer:
+//   GET /tiles/<seed>/<z>/<x>/<y>.png
+// A tile is one world chunk at the deepest zoom, and each zoom out halves the scale. Tiles
+// are drawn on the CPU from World's chunks, so nothing here touches GL. One thread accepts,
+// a fixed pool answers, and anything past what the pool can queue gets a 503.
+class TileServer
+{
+public:
+	TileServer(World& world);
+	~TileServer();
+
+	bool Start(int port);
+	void Stop();
+	bool IsRunning() const { return running; }
+	int GetPort() const { return port; }
+
+	void PrintStats();
+
+private:
+	// (seed, z, x, y)
+	typedef std::tuple<int, int, int, int> TileKey;
+	// (seed, x, y)
+	typedef std::tuple<int, int, int> ChunkKey;
+	typedef std::shared_ptr<const std::string> TileData;
+	typedef std::shared_ptr<const World::ChunkContents> ChunkData;
+
+	// one tile being drawn; anyone else after it waits for this rather than drawing it again
+	struct PendingTile {
+		bool done = false;
+		TileData png;
+	};
+	struct CachedTile {
+		TileData png;
+		std::list<TileKey>::iterator lru;
+	};
+	struct CachedChunk {
+		ChunkData contents;
+		std::list<ChunkKey>::iterator lru;
+	};
+
+	void AcceptLoop();
+	void WorkerLoop();
+	void Handle(Socket& client);
+	void Respond(Socket& client, const char* status, const std::string& headers, const char* body, size_t size);
+
+	std::string ETag(const TileKey& key);
+	TileData GetTile(const TileKey& key);
+	void RenderTile(const TileKey& key, ofPixels& out);
+	ChunkData GetChunk(int seed, int x, int y);
+	void DrawChunk(const World::ChunkContents& chunk, ofPixels& scratch);
+
+	World& world;
+	int port;
+	std::atomic<bool> running;
+
+	Socket listener;
+	std::thread acceptThread;
+	vector<std::thread> workers;
+
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable tileReady;
+	std::deque<Socket> connections;
+
+	std::map<TileKey, std::shared_ptr<PendingTile>> pending;
+	std::map<TileKey, CachedTile> tiles;
+	std::list<TileKey> tileLru;
+	size_t tileBytes;
+
+	std::mutex chunkMutex;
+	std::map<ChunkKey, CachedChunk> chunks;
+	std::list<ChunkKey> chunkLru;
+
+	// for PrintStats
+	int requests;
+	int rendered;
+	// milliseconds spent rendering them
+	float renderTime;
+	int cacheHits;
+	int coalesced;
+	int notModified;
+	int rejected;
+};
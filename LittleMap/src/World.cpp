@@ -0,0 +1,468 @@
+#include "World.h"
+
+#include <cmath>
+
+// multiple of CurveTerrain's cellSize, so every chunk starts on the lattice
+const int worldChunkSize = 320;
+// chunks kept around after they scroll out of view
+const int worldChunkCache = 64;
+// Landmarks' placement squares, but a whole number of them to a chunk
+const int worldPlacementSize = 160;
+
+// one stream per lattice cell, so the stipples of a cell are the same whichever chunk draws it
+static uint64_t CellSeed(int seed, int x, int y, int salt)
+{
+	return ((uint64_t)(uint32_t)seed * 0x9E3779B97F4A7C15ull)
+		^ ((uint64_t)(uint32_t)x << 32 | (uint32_t)y)
+		^ ((uint64_t)salt << 61);
+}
+
+World::World(Landmarks& landmarks)
+	: landmarks(landmarks)
+	, seed(0)
+	, generating(0)
+	, quit(false)
+{
+}
+
+World::~World()
+{
+	Stop();
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		quit = true;
+	}
+	wake.notify_all();
+	for (auto& thread : threads)
+	{
+		thread.join();
+	}
+}
+
+void World::Setup(int threadCount)
+{
+	for (int i = 0; i < threadCount; i++)
+	{
+		threads.push_back(std::thread(&World::WorkerLoop, this));
+	}
+}
+
+void World::Update(const ofRectangle& view)
+{
+	int x0 = (int)std::floor(view.getMinX() / worldChunkSize);
+	int y0 = (int)std::floor(view.getMinY() / worldChunkSize);
+	int x1 = (int)std::floor(view.getMaxX() / worldChunkSize);
+	int y1 = (int)std::floor(view.getMaxY() / worldChunkSize);
+	ofPoint centre = view.getCenter() / worldChunkSize;
+
+	vector<Chunk*> toUpload;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		// whatever was queued but has scrolled away since can wait until it's back
+		for (auto it = queue.begin(); it != queue.end();)
+		{
+			if (it->seed != seed || it->x < x0 || it->x > x1 || it->y < y0 || it->y > y1)
+			{
+				auto found = chunks.find(*it);
+				lru.erase(found->second.lru);
+				chunks.erase(found);
+				it = queue.erase(it);
+			}
+			else
+			{
+				it++;
+			}
+		}
+
+		vector<ChunkKey> missing;
+		for (int y = y0; y <= y1; y++)
+		{
+			for (int x = x0; x <= x1; x++)
+			{
+				ChunkKey key{ seed, x, y };
+				if (chunks.find(key) == chunks.end())
+					missing.push_back(key);
+			}
+		}
+
+		// in view or not, so they can be evicted like the rest
+		for (auto& it : chunks)
+		{
+			if (it.second.state == Chunk::Generated)
+				toUpload.push_back(&it.second);
+		}
+
+		// nearest the middle of the view first
+		std::sort(missing.begin(), missing.end(), [&](const ChunkKey& a, const ChunkKey& b) {
+			return ofPoint(a.x + 0.5f, a.y + 0.5f).distance(centre) < ofPoint(b.x + 0.5f, b.y + 0.5f).distance(centre);
+		});
+		for (auto& key : missing)
+		{
+			Chunk& chunk = chunks[key];
+			chunk.state = Chunk::Queued;
+			chunk.lru = lru.insert(lru.end(), key);
+			queue.push_back(key);
+		}
+		if (!missing.empty())
+			wake.notify_all();
+	}
+
+	// Generated chunks are left alone by the workers, and only this thread evicts
+	for (Chunk* chunk : toUpload)
+	{
+		Upload(*chunk);
+		std::lock_guard<std::mutex> lock(mutex);
+		chunk->state = Chunk::Uploaded;
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+	Evict();
+}
+
+void World::Upload(Chunk& chunk)
+{
+	ofTexture fill;
+	fill.loadData(chunk.contents.fill);
+
+	chunk.image.allocate(worldChunkSize, worldChunkSize, GL_RGBA);
+	chunk.image.begin();
+	ofClear(0, 0, 0, 0);
+	ofSetColor(ofColor::white);
+	fill.draw(0, 0);
+
+	ofFill();
+	ofEnableSmoothing();
+	ofSetColor(ofColor::black);
+	for (auto& stipple : chunk.contents.stipples)
+	{
+		ofDrawCircle(stipple.pos, stipple.radius);
+	}
+	chunk.image.end();
+
+	// only the image is needed from here on
+	chunk.contents.fill.clear();
+	chunk.contents.stipples.clear();
+	chunk.contents.stipples.shrink_to_fit();
+}
+
+void World::Touch(Chunk& chunk)
+{
+	lru.splice(lru.end(), lru, chunk.lru);
+}
+
+void World::Evict()
+{
+	for (auto it = lru.begin(); it != lru.end() && chunks.size() > worldChunkCache;)
+	{
+		auto found = chunks.find(*it);
+		// anything still waiting on a worker stays
+		if (found->second.state != Chunk::Uploaded)
+		{
+			it++;
+			continue;
+		}
+		chunks.erase(found);
+		it = lru.erase(it);
+	}
+}
+
+void World::Draw(const ofRectangle& view)
+{
+	int x0 = (int)std::floor(view.getMinX() / worldChunkSize);
+	int y0 = (int)std::floor(view.getMinY() / worldChunkSize);
+	int x1 = (int)std::floor(view.getMaxX() / worldChunkSize);
+	int y1 = (int)std::floor(view.getMaxY() / worldChunkSize);
+
+	// uploaded chunks are only ever removed by Update, on this thread, so they can be drawn
+	// outside the lock
+	vector<std::pair<Chunk*, ofPoint>> visible;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		for (int y = y0; y <= y1; y++)
+		{
+			for (int x = x0; x <= x1; x++)
+			{
+				auto found = chunks.find(ChunkKey{ seed, x, y });
+				if (found == chunks.end() || found->second.state != Chunk::Uploaded)
+					continue;
+				Touch(found->second);
+				ofPoint pos(x * worldChunkSize - view.getMinX(), y * worldChunkSize - view.getMinY());
+				visible.push_back(std::make_pair(&found->second, pos));
+			}
+		}
+	}
+
+	// the sea until a chunk turns up
+	ofSetColor(seaFillColor);
+	ofFill();
+	ofDrawRectangle(0, 0, view.getWidth(), view.getHeight());
+
+	ofSetColor(ofColor::white);
+	for (auto& it : visible)
+	{
+		it.first->image.draw(it.second.x, it.second.y);
+	}
+
+	// icons go on top, so one near the edge of its chunk isn't cut off by the next
+	ofEnableAlphaBlending();
+	for (auto& it : visible)
+	{
+		for (auto& landmark : it.first->contents.landmarks)
+		{
+			ofSetColor(255, 255, 255, landmark.onLand > 0 ? 255 : 150);
+			landmarks.DrawIcon(landmark.iconIdx, landmark.pos - view.getPosition());
+		}
+	}
+	ofDisableAlphaBlending();
+}
+
+void World::Stop()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	for (auto& key : queue)
+	{
+		auto found = chunks.find(key);
+		lru.erase(found->second.lru);
+		chunks.erase(found);
+	}
+	queue.clear();
+	idle.wait(lock, [this]() { return generating == 0; });
+}
+
+int World::GetChunkCount()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return chunks.size();
+}
+
+int World::GetPendingCount()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return queue.size() + generating;
+}
+
+void World::WorkerLoop()
+{
+	while (true)
+	{
+		ChunkKey key;
+		Chunk* chunk;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [this]() { return quit || !queue.empty(); });
+			if (quit)
+				return;
+			key = queue.front();
+			queue.pop_front();
+			// std::map never moves its nodes, and a Generating chunk isn't evicted
+			chunk = &chunks[key];
+			chunk->state = Chunk::Generating;
+			generating++;
+		}
+
+		GenerateChunk(key.seed, key.x, key.y, chunk->contents);
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			chunk->state = Chunk::Generated;
+			generating--;
+		}
+		idle.notify_all();
+	}
+}
+
+int World::GetChunkSize() const
+{
+	return worldChunkSize;
+}
+
+void World::BlendIcon(const Landmarks::Landmark& landmark, ofPixels& target, ofPoint origin, float zoom) const
+{
+	landmarks.BlendIcon(landmark.iconIdx, landmark.pos, landmark.onLand > 0 ? 255 : 150, target, origin, zoom);
+}
+
+// Land values on the cell lattice, one cell past the chunk on every side. Everything else is
+// worked out from these, so two chunks agree wherever they overlap.
+void World::GenerateChunk(int seed, int chunkX, int chunkY, ChunkContents& out)
+{
+	Generator generator;
+	generator.Seed(seed);
+
+	const int cells = worldChunkSize / cellSize;
+	const int stride = cells + 3;
+	const int originX = chunkX * cells - 1;
+	const int originY = chunkY * cells - 1;
+	vector<float> corners;
+	SampleCorners(generator, chunkX, chunkY, corners);
+
+	// land or sea per pixel, blended from the corners of its cell so it lines up with the coast
+	out.fill.allocate(worldChunkSize, worldChunkSize, 3);
+	for (int py = 0; py < worldChunkSize; py++)
+	{
+		int cy = py / cellSize + 1;
+		float fy = (py % cellSize + 0.5f) / cellSize;
+		for (int px = 0; px < worldChunkSize; px++)
+		{
+			int cx = px / cellSize + 1;
+			float fx = (px % cellSize + 0.5f) / cellSize;
+			const float* c = &corners[cy * stride + cx];
+			float top = c[0] + (c[1] - c[0]) * fx;
+			float bottom = c[stride] + (c[stride + 1] - c[stride]) * fx;
+			float value = top + (bottom - top) * fy;
+			out.fill.setColor(px, py, value > 0 ? landFillColor : seaFillColor);
+		}
+	}
+
+	// Marching squares over the cells in the chunk and the ring around it; stipples from the
+	// ring overhang the border and are drawn by both chunks, clipped to each.
+	out.stipples.clear();
+	for (int y = 0; y < stride - 1; y++)
+	{
+		for (int x = 0; x < stride - 1; x++)
+		{
+			const float* c = &corners[y * stride + x];
+			float v[4] = { c[0], c[1], c[stride + 1], c[stride] };
+			int mask = (v[0] > 0 ? 1 : 0) | (v[1] > 0 ? 2 : 0) | (v[2] > 0 ? 4 : 0) | (v[3] > 0 ? 8 : 0);
+			if (mask == 0 || mask == 15)
+				continue;
+
+			// where the coast crosses each edge: top, right, bottom, left
+			ofPoint corner(x * cellSize - cellSize, y * cellSize - cellSize);
+			ofPoint offsets[4] = { ofPoint(0, 0), ofPoint(cellSize, 0), ofPoint(cellSize, cellSize), ofPoint(0, cellSize) };
+			ofPoint crossings[4];
+			bool crosses[4];
+			for (int e = 0; e < 4; e++)
+			{
+				float a = v[e];
+				float b = v[(e + 1) % 4];
+				crosses[e] = (a > 0) != (b > 0);
+				if (crosses[e])
+					crossings[e] = corner + offsets[e] + (offsets[(e + 1) % 4] - offsets[e]) * (a / (a - b));
+			}
+
+			// two crossings is one segment; four is a saddle, split by the value in the middle
+			vector<std::pair<int, int>> segments;
+			int edges[4];
+			int count = 0;
+			for (int e = 0; e < 4; e++)
+			{
+				if (crosses[e])
+					edges[count++] = e;
+			}
+			if (count == 2)
+			{
+				segments.push_back(std::make_pair(edges[0], edges[1]));
+			}
+			else if (count == 4)
+			{
+				bool middleLand = (v[0] + v[1] + v[2] + v[3]) > 0;
+				bool firstLand = v[0] > 0;
+				if (middleLand == firstLand)
+				{
+					segments.push_back(std::make_pair(0, 1));
+					segments.push_back(std::make_pair(2, 3));
+				}
+				else
+				{
+					segments.push_back(std::make_pair(3, 0));
+					segments.push_back(std::make_pair(1, 2));
+				}
+			}
+
+			Random rng(CellSeed(seed, originX + x, originY + y, 0));
+			for (auto& segment : segments)
+			{
+				ofPoint from = crossings[segment.first];
+				ofPoint to = crossings[segment.second];
+				float length = from.distance(to);
+				for (float along = 0; along < length; along += 1.0f)
+				{
+					out.stipples.push_back(Stipple{ from + (to - from) * (along / length), rng.Range(1.5f, 3.0f) });
+				}
+			}
+		}
+	}
+
+	PlaceLandmarks(seed, chunkX, chunkY, out.landmarks, corners, stride);
+}
+
+void World::GenerateLandmarks(int seed, int chunkX, int chunkY, vector<Landmarks::Landmark>& out)
+{
+	Generator generator;
+	generator.Seed(seed);
+
+	vector<float> corners;
+	SampleCorners(generator, chunkX, chunkY, corners);
+	PlaceLandmarks(seed, chunkX, chunkY, out, corners, worldChunkSize / cellSize + 3);
+}
+
+void World::SampleCorners(const Generator& generator, int chunkX, int chunkY, vector<float>& corners)
+{
+	const int cells = worldChunkSize / cellSize;
+	const int stride = cells + 3;
+	const int originX = chunkX * cells - 1;
+	const int originY = chunkY * cells - 1;
+	corners.resize(stride * stride);
+	for (int y = 0; y < stride; y++)
+	{
+		generator.NoiseRow(&corners[y * stride], stride, originX * cellSize, cellSize,
+			(originY + y) * cellSize, noiseScale, landOctaves);
+		for (int x = 0; x < stride; x++)
+		{
+			corners[y * stride + x] -= seaLevel;
+		}
+	}
+}
+
+// The same rules Landmarks uses, but only against landmarks in the same chunk, so a chunk's
+// landmarks never depend on what its neighbours placed.
+void World::PlaceLandmarks(int seed, int chunkX, int chunkY, vector<Landmarks::Landmark>& out, const vector<float>& corners, int stride)
+{
+	out.clear();
+	int iconCount = landmarks.GetIconCount();
+	if (iconCount == 0)
+		return;
+
+	Random rng(CellSeed(seed, chunkX, chunkY, 1));
+	ofPoint chunkOrigin(chunkX * worldChunkSize, chunkY * worldChunkSize);
+	for (int y = 0; y < worldChunkSize; y += worldPlacementSize)
+	{
+		for (int x = 0; x < worldChunkSize; x += worldPlacementSize)
+		{
+			Landmarks::Landmark landmark;
+			landmark.iconIdx = rng.Int(iconCount);
+			for (int attempt = 0; attempt < 10; attempt++)
+			{
+				float px = x + rng.Range(worldPlacementSize);
+				float py = y + rng.Range(worldPlacementSize);
+				ofPoint pt(px, py);
+
+				// A chunk has no distance field, so the distance to the coast is guessed from the
+				// land value and its slope; the corners are a cell apart, and one further in.
+				GridSample sample = SampleBilinear(corners.data(), stride, stride, pt.x / cellSize + 1, pt.y / cellSize + 1);
+				float onLand = sample.value;
+				if (sample.DistanceToZero() * cellSize < shoreClearance)
+					continue;
+
+				bool found = true;
+				float avoidRadius = onLand > 0 ? avoidRadiusLand : avoidRadiusWater;
+				for (auto& other : out)
+				{
+					if (other.pos.distance(chunkOrigin + pt) < avoidRadius)
+					{
+						found = false;
+						break;
+					}
+				}
+				if (found)
+				{
+					landmark.pos = chunkOrigin + pt;
+					landmark.onLand = onLand;
+					out.push_back(landmark);
+					break;
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,109 @@
+#pragma once
+#include "ofMain.h"
+
+#include "Generator.h"
+#include "Landmarks.h"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <map>
+
+// A map that goes on forever, cut into square chunks that are generated as they scroll into
+// view. A chunk only depends on (seed, chunkX, chunkY), so the same chunk always comes out the
+// same, whatever was generated around it or before it. Coastlines are traced on one lattice
+// across the whole world, so they meet up across chunk borders.
+class World
+{
+public:
+	World(Landmarks& landmarks);
+	~World();
+
+	void Setup(int threads);
+	void SetSeed(int seed) { this->seed = seed; }
+	int GetSeed() const { return seed; }
+
+	// On the GL thread: uploads finished chunks and queues the ones in view that are missing.
+	void Update(const ofRectangle& view);
+	// view is in world pixels, drawn at the window's top left
+	void Draw(const ofRectangle& view);
+	// waits for the chunks being generated and drops everything queued
+	void Stop();
+
+	int GetChunkCount();
+	int GetPendingCount();
+
+	struct Stipple {
+		ofPoint pos;
+		float radius;
+	};
+
+	// What a chunk is made of, before anything is drawn. Only depends on (seed, x, y), and
+	// safe to make on any thread.
+	struct ChunkContents {
+		ofPixels fill;
+		// in chunk pixels; the ones from the ring of cells around the chunk hang over its edges
+		vector<Stipple> stipples;
+		// in world pixels
+		vector<Landmarks::Landmark> landmarks;
+	};
+	void GenerateChunk(int seed, int x, int y, ChunkContents& out);
+	// just a chunk's landmarks, for much less than the whole chunk
+	void GenerateLandmarks(int seed, int x, int y, vector<Landmarks::Landmark>& out);
+	int GetChunkSize() const;
+	// a landmark's icon, as Draw shows it, into pixels zoomed out by zoom with origin at the top left
+	void BlendIcon(const Landmarks::Landmark& landmark, ofPixels& target, ofPoint origin, float zoom) const;
+
+private:
+	struct ChunkKey {
+		int seed;
+		int x;
+		int y;
+		bool operator<(const ChunkKey& other) const
+		{
+			return seed != other.seed ? seed < other.seed
+				: x != other.x ? x < other.x
+				: y < other.y;
+		}
+	};
+
+	struct Chunk {
+		enum State {
+			Queued,
+			Generating,
+			Generated,
+			Uploaded,
+		};
+		State state;
+		std::list<ChunkKey>::iterator lru;
+
+		ChunkContents contents;
+		ofFbo image;
+	};
+
+	void WorkerLoop();
+	void SampleCorners(const Generator& generator, int chunkX, int chunkY, vector<float>& corners);
+	void PlaceLandmarks(int seed, int x, int y, vector<Landmarks::Landmark>& out, const vector<float>& corners, int stride);
+	void Upload(Chunk& chunk);
+	void Touch(Chunk& chunk);
+	void Evict();
+
+	Landmarks& landmarks;
+	int seed;
+
+	// everything below is guarded by mutex; a chunk's contents belong to whichever thread
+	// moved it out of Queued until it's Generated
+	std::map<ChunkKey, Chunk> chunks;
+	// least recently drawn first
+	std::list<ChunkKey> lru;
+	std::deque<ChunkKey> queue;
+
+	vector<std::thread> threads;
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable idle;
+	int generating;
+	bool quit;
+};
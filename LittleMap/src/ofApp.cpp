@@ -6,8 +6,12 @@
 #include "Landmarks.h"
 #include "Paths.h"
 #include "Legend.h"
+#include "Labels.h"
 #include "Paper.h"
 #include "Saver.h"
+#include "Snapshot.h"
+
+#include <chrono>
 
 
 char* nextMessage;
@@ -18,6 +22,17 @@ void statusMessage(char* message)
 	nextMessage = message;
 }
 
+// 'l' starts the map over from the snapshots of every step before the current one
+const bool writeSnapshots = true;
+const int tileServerPort = 8765;
+// 'p' writes the map at full size and this many halvings
+const int pyramidLevels = 4;
+
+std::string SnapshotPath(int step)
+{
+	return "../snapshot-" + ofToString(step) + ".bin";
+}
+
 char* subMessage;
 void statusMessage2(char* message)
 {
@@ -41,27 +56,42 @@ void ofApp::setup()
 
 	Start *start = new Start();
 	stages[(int)step::start] = start;
+	Generator &generator = start->GetGenerator();
+	this->generator = &generator;
 
-	CurveTerrain *terrain = new CurveTerrain(false, false);
+	CurveTerrain *terrain = new CurveTerrain(generator, false, false);
 	stages[(int)step::islands] = terrain;
 
-	LatLon *latLon = new LatLon();
+	LatLon *latLon = new LatLon(generator);
 	stages[(int)step::lines] = latLon;
 	
-	Landmarks *landmarks = new Landmarks(*terrain);
+	Landmarks *landmarks = new Landmarks(generator, *terrain);
 	stages[(int)step::landmarks] = landmarks;
 
-	Paths *paths = new Paths(*terrain, *landmarks, 0);
+	Paths *paths = new Paths(generator, *terrain, *landmarks, 0);
 	stages[(int)step::paths] = paths;
 
-	Legend *legend = new Legend(*landmarks, *paths);
+	Legend *legend = new Legend(generator, *landmarks, *paths);
 	stages[(int)step::legend] = legend;
 
-	Paper *paper = new Paper(*legend);
+	Labels *labels = new Labels(*terrain, *landmarks, *paths, *legend);
+	stages[(int)step::labels] = labels;
+
+	Paper *paper = new Paper(generator, *legend);
 	stages[(int)step::paper] = paper;
 
+	world = new World(*landmarks);
+	worldMode = false;
+	tileServer = new TileServer(*world);
+
 	Saver *saver = new Saver();
 	stages[(int)step::save] = saver;
+	// grabs the screen, so it waits for everything else
+	for (int i = 0; i < (int)step::save; i++)
+	{
+		if (stages[i] != NULL)
+			saver->DependsOn(stages[i]);
+	}
 
 
 
@@ -71,9 +101,10 @@ void ofApp::setup()
 	drawOrder[2] = latLon;
 	drawOrder[3] = landmarks;
 	drawOrder[4] = paths;
-	drawOrder[5] = paper;
-	drawOrder[6] = legend;
-	drawOrder[7] = saver;
+	drawOrder[5] = labels;
+	drawOrder[6] = paper;
+	drawOrder[7] = legend;
+	drawOrder[8] = saver;
 
 
 	for (int i = 0; i < (int)step::done; i++)
@@ -81,16 +112,27 @@ void ofApp::setup()
 		if (stages[i] != NULL)
 			stages[i]->Setup();
 	}
+
+	scheduler.Setup(stages, (int)step::done, std::max(1, (int)std::thread::hardware_concurrency() - 1));
+	snapshotWritten.assign((int)step::done, false);
+	world->Setup(std::max(1, (int)std::thread::hardware_concurrency() - 1));
 }
 
 //--------------------------------------------------------------
 void ofApp::update()
 {
+	if (worldMode)
+		world->Update(ofRectangle(worldView, ofGetWidth(), ofGetHeight()));
+
 	if (!doneStep && currentStep < step::done)
 	{
+		// when stepping by hand, nothing past the current step gets started
+		scheduler.Update(autoAdvance ? (int)step::done - 1 : (int)currentStep);
+		WriteSnapshots();
+
 		if (stages[(int)currentStep] != NULL)
 		{
-			doneStep = stages[(int)currentStep]->Render();
+			doneStep = scheduler.IsComplete((int)currentStep);
 		}
 		else
 		{
@@ -105,6 +147,97 @@ void ofApp::update()
 	}
 }
 
+void ofApp::WriteSnapshots()
+{
+	if (!writeSnapshots)
+		return;
+
+	for (int i = 0; i < (int)step::done; i++)
+	{
+		if (snapshotWritten[i] || stages[i] == nullptr || !scheduler.IsComplete(i))
+			continue;
+		snapshotWritten[i] = true;
+
+		std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+		SnapshotWriter out;
+		if (!stages[i]->WriteSnapshot(out) || !out.Save(SnapshotPath(i), i, generator->GetSeed()))
+			continue;
+
+		float elapsed = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+		printf("Wrote snapshot for step %d in %.2fms\n", i, elapsed);
+	}
+}
+
+void ofApp::ReadSnapshots(int before)
+{
+	// Start is first, and sets the seed everything else has to match
+	vector<bool> read((int)step::done, false);
+	int seed = 0;
+	for (int i = 0; i < before && i < (int)step::done; i++)
+	{
+		if (stages[i] == nullptr)
+			continue;
+
+		// a stage is only read back if everything it was made from was too
+		bool inputsRead = i == 0 || read[0];
+		for (Stage* input : stages[i]->GetInputs())
+		{
+			int idx = std::find(stages, stages + (int)step::done, input) - stages;
+			inputsRead = inputsRead && read[idx];
+		}
+
+		SnapshotReader in;
+		if (!inputsRead || !in.Open(SnapshotPath(i), i) || (i > 0 && in.GetSeed() != seed))
+			continue;
+
+		if (!stages[i]->ReadSnapshot(in) || !in.IsDone())
+		{
+			// half read, so start it over
+			printf("Snapshot for step %d doesn't match, generating it\n", i);
+			stages[i]->Reset();
+			continue;
+		}
+
+		if (i == 0)
+			seed = in.GetSeed();
+		read[i] = true;
+		snapshotWritten[i] = true;
+		scheduler.SetGenerated(i);
+		printf("Read snapshot for step %d\n", i);
+	}
+}
+
+void ofApp::ExportPyramid()
+{
+	std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+	ofFbo level;
+	ofPixels pixels;
+	for (int i = 0; i < pyramidLevels; i++)
+	{
+		float scale = 1.0f / (1 << i);
+		int width = (int)std::ceil(ofGetWidth() * scale);
+		int height = (int)std::ceil(ofGetHeight() * scale);
+		level.allocate(width, height, GL_RGB);
+		level.begin();
+		ofClear(0, 0, 0, 255);
+		for (int s = 0; s < (int)step::done; s++)
+		{
+			if (drawOrder[s] != NULL)
+				drawOrder[s]->DrawLevel(scale);
+		}
+		level.end();
+
+		level.readToPixels(pixels);
+		char filename[64];
+		sprintf(filename, "little_map-%d-z%d.png", generator->GetSeed(), i);
+		ofSaveImage(pixels, filename);
+	}
+
+	float elapsed = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+	printf("Exported %d levels in %.2fms\n", pyramidLevels, elapsed);
+}
+
 void ofApp::Advance()
 {
 	doneStep = false;
@@ -131,11 +264,14 @@ void ofApp::Advance()
 	case(step::legend):
 		statusMessage("5: Legend");
 		break;
+	case(step::labels):
+		statusMessage("6: Labels");
+		break;
 	case(step::paper):
-		statusMessage("6: Paper");
+		statusMessage("7: Paper");
 		break;
 	case(step::save):
-		statusMessage("7: Save");
+		statusMessage("8: Save");
 		break;
 	case(step::done):
 		statusMessage("Done");
@@ -150,6 +286,20 @@ int i = 0;
 
 void ofApp::draw()
 {
+	if (worldMode)
+	{
+		world->Draw(ofRectangle(worldView, ofGetWidth(), ofGetHeight()));
+
+		char worldMessage[128];
+		sprintf(worldMessage, "World %d at %d,%d: %d chunks, %d to go", world->GetSeed(),
+			(int)worldView.x, (int)worldView.y, world->GetChunkCount(), world->GetPendingCount());
+		ofSetColor(ofColor::black);
+		ofDrawBitmapString(worldMessage, 11, ofGetHeight() - 9);
+		ofSetColor(ofColor::white);
+		ofDrawBitmapString(worldMessage, 10, ofGetHeight() - 10);
+		return;
+	}
+
 	for (int i = 0; i < (int)step::done; i++)
 	{
 		if (drawOrder[i] != NULL)
@@ -180,6 +330,7 @@ void ofApp::draw()
 void ofApp::keyPressed(int key)
 {
 	int targetStep = ((int)currentStep) + 1;
+	bool loadSnapshots = false;
 	if (key == ' ')
 	{
 		if (doneStep)
@@ -195,6 +346,66 @@ void ofApp::keyPressed(int key)
 		targetStep = 0;
 		autoAdvance = true;
 	}
+	else if (key == 'l')
+	{
+		loadSnapshots = true;
+		targetStep = 0;
+		autoAdvance = true;
+	}
+	else if (key == 'w')
+	{
+		worldMode = !worldMode;
+		if (worldMode)
+		{
+			// starts where the map is, on the same seed
+			world->SetSeed(generator->GetSeed());
+			worldView = ofPoint(0, 0);
+		}
+		else
+		{
+			world->Stop();
+		}
+	}
+	else if (key == 'p')
+	{
+		// needs everything drawn
+		if (currentStep == done)
+			ExportPyramid();
+		else
+			printf("Finish the map before exporting it\n");
+	}
+	else if (key == 'h')
+	{
+		if (tileServer->IsRunning())
+		{
+			tileServer->PrintStats();
+			tileServer->Stop();
+		}
+		else
+		{
+			tileServer->Start(tileServerPort);
+		}
+	}
+	else if (key == 'b')
+	{
+		if (scheduler.IsComplete((int)step::islands))
+			static_cast<Paths*>(stages[(int)step::paths])->BenchmarkExpansion();
+		else
+			printf("Wait for the terrain before benchmarking\n");
+	}
+	else if (key == 'H')
+	{
+		if (tileServer->IsRunning())
+			loadTest.Start(tileServerPort, generator->GetSeed(), 8, 50);
+		else
+			printf("Start the tile server with 'h' first\n");
+	}
+	else if (worldMode && (key == OF_KEY_LEFT || key == OF_KEY_RIGHT || key == OF_KEY_UP || key == OF_KEY_DOWN))
+	{
+		float panStep = ofGetWidth() / 4;
+		worldView.x += key == OF_KEY_LEFT ? -panStep : key == OF_KEY_RIGHT ? panStep : 0;
+		worldView.y += key == OF_KEY_UP ? -panStep : key == OF_KEY_DOWN ? panStep : 0;
+	}
 	else if (key == 'a')
 	{
 		autoAdvance = !autoAdvance;
@@ -250,15 +461,26 @@ void ofApp::keyPressed(int key)
 		autoAdvance = false;
 	}
 
-	bool reset = false;
-	for (int i = currentStep; i >= targetStep; i--)
-	{
-		if (i < (int)done && stages[i] != nullptr)
-			stages[i]->Reset();
-		reset = true;
-	}
-	if (reset)
+	if (currentStep >= targetStep)
 	{
+		scheduler.Stop();
+		// stages past the current one may already have been started too
+		for (int i = (int)done - 1; i >= targetStep; i--)
+		{
+			if (stages[i] != nullptr && (i <= currentStep || scheduler.WasStarted(i)))
+				stages[i]->Reset();
+		}
+		scheduler.Restart(targetStep);
+		for (int i = targetStep; i < (int)done; i++)
+		{
+			snapshotWritten[i] = false;
+		}
+		if (loadSnapshots)
+		{
+			// everything when the map is finished, otherwise up to where it had got
+			ReadSnapshots(currentStep == done ? (int)done : (int)currentStep);
+		}
+
 		currentStep = (step)(targetStep-1);
 		Advance();
 	}
@@ -274,13 +496,24 @@ void ofApp::mouseMoved(int x, int y ){
 }
 
 //--------------------------------------------------------------
-void ofApp::mouseDragged(int x, int y, int button){
-
+void ofApp::mouseDragged(int x, int y, int button)
+{
+	if (worldMode)
+	{
+		worldView += dragFrom - ofPoint(x, y);
+		dragFrom = ofPoint(x, y);
+	}
 }
 
 //--------------------------------------------------------------
 void ofApp::mousePressed(int x, int y, int button)
 {
+	if (worldMode)
+	{
+		dragFrom = ofPoint(x, y);
+		return;
+	}
+
 	if (stages[currentStep] != nullptr)
 	{
 		stages[currentStep]->DebugClick(x, y);
@@ -314,11 +547,22 @@ void ofApp::gotMessage(ofMessage msg){
 
 //--------------------------------------------------------------
 void ofApp::dragEvent(ofDragInfo dragInfo){ 
-
+	if (dragInfo.files.empty())
+		return;
+
+	// a dropped heightfield replaces the noise, and the map is redrawn on it; anything
+	// that isn't one puts the noise back
+	scheduler.Stop();
+	static_cast<CurveTerrain*>(stages[(int)step::islands])->LoadRaster(dragInfo.files[0]);
+	keyPressed('r');
 }
 
 void ofApp::exit()
 {
+	scheduler.Stop();
+	world->Stop();
+	tileServer->Stop();
+
 	if (stages[(int)save] != nullptr)
 	{
 		((Saver*)stages[(int)save])->Save(true);
@@ -2,6 +2,11 @@
 
 #include "ofMain.h"
 #include "Stage.h"
+#include "Scheduler.h"
+#include "Generator.h"
+#include "World.h"
+#include "TileServer.h"
+#include "TileLoadTest.h"
 
 class ofApp : public ofBaseApp{
 
@@ -33,6 +38,7 @@ private:
 		landmarks,
 		paths,
 		legend,
+		labels,
 		paper,
 
 		save,
@@ -41,6 +47,11 @@ private:
 	};
 
 	void Advance();
+	void WriteSnapshots();
+	// every zoom level of the finished map in one go, each half the size of the last
+	void ExportPyramid();
+	// reads back every stage before the given step that has a snapshot for this map
+	void ReadSnapshots(int before);
 
 	bool autoAdvance;
 	bool doneStep;
@@ -48,4 +59,21 @@ private:
 
 	Stage** stages;
 	Stage** drawOrder;
+
+	// runs each stage once its inputs are done, independent ones side by side
+	Scheduler scheduler;
+
+	Generator* generator;
+	// each stage's output is saved once, as soon as it's complete
+	vector<bool> snapshotWritten;
+
+	// 'w' swaps the map for an endless one, made of chunks, that can be dragged around
+	World* world;
+	bool worldMode;
+	ofPoint worldView;
+	ofPoint dragFrom;
+
+	// 'h' serves the world as tiles on loopback, 'H' runs a load test against that
+	TileServer* tileServer;
+	TileLoadTest loadTest;
 };